@@ -0,0 +1,95 @@
+/**
+ *
+ * comparator.cpp
+ *
+ * Times sorting an index permutation of many todos with the orderings of
+ * todo.h, passed as a type, against the same comparisons made out of line
+ * and called through std::function as todo_list did before:
+ * comparator [todos], by default 1000000
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/todo.h"
+
+using namespace p2d;
+using namespace std;
+
+namespace {
+    constexpr int rounds = 5;
+
+    using function_order = function<bool(const todo &, const todo &)>;
+
+    // The comparators before, which the compiler could not see into
+    [[gnu::noinline]] bool deadline_id(const todo &lhs, const todo &rhs) {
+        if (lhs.get_deadline() != rhs.get_deadline())
+            return lhs.get_deadline() < rhs.get_deadline();
+        return lhs.get_id() < rhs.get_id();
+    }
+
+    [[gnu::noinline]] bool title_id(const todo &lhs, const todo &rhs) {
+        if (lhs.get_title() != rhs.get_title())
+            return lhs.get_title() < rhs.get_title();
+        return lhs.get_id() < rhs.get_id();
+    }
+
+    [[gnu::noinline]] bool deadline_title_id(const todo &lhs, const todo &rhs) {
+        if (lhs.get_deadline() != rhs.get_deadline())
+            return lhs.get_deadline() < rhs.get_deadline();
+        return title_id(lhs, rhs);
+    }
+
+    // Best of rounds, each sorting a copy of the same shuffled permutation
+    template <typename Compare>
+    double sort_ms(const vector<todo> &todos, const vector<uint32_t> &shuffled, Compare cmp) {
+        double best = 0;
+        for (int r = 0; r < rounds; r++) {
+            vector<uint32_t> view = shuffled;
+            const auto start = chrono::steady_clock::now();
+            sort(begin(view), end(view), [&](uint32_t a, uint32_t b) {
+                return cmp(todos[a], todos[b]);
+            });
+            const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            best = r == 0 ? ms : min(best, ms);
+        }
+        return best;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const size_t size = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1'000'000;
+
+    // Enough repeated deadlines and titles that the tie-breaks run
+    mt19937 gen { 1 };
+    vector<todo> todos;
+    todos.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+        todos.emplace_back(todo_ids().next(), "task " + to_string(gen() % 100'000), "",
+            todo::time_pt {} + chrono::hours { gen() % 100'000 });
+    }
+    vector<uint32_t> shuffled(size);
+    iota(begin(shuffled), end(shuffled), 0u);
+    shuffle(begin(shuffled), end(shuffled), gen);
+
+    cout << size << " todos, best of " << rounds << " sorts, in ms\n"
+         << "ordering\tstd::function\ttemplate\n";
+    cout << "deadline, id\t" << sort_ms(todos, shuffled, function_order { deadline_id }) << '\t'
+         << sort_ms(todos, shuffled, order::stable<order::by_deadline> {}) << '\n';
+    cout << "title, id\t" << sort_ms(todos, shuffled, function_order { title_id }) << '\t'
+         << sort_ms(todos, shuffled, order::stable<order::by_title> {}) << '\n';
+    cout << "deadline, title, id\t" << sort_ms(todos, shuffled, function_order { deadline_title_id }) << '\t'
+         << sort_ms(todos, shuffled, order::stable<order::by_deadline, order::by_title> {}) << '\n';
+
+    return 0;
+}
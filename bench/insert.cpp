@@ -0,0 +1,96 @@
+/**
+ *
+ * insert.cpp
+ *
+ * Times todo_list::add by list size against the insert it replaced, a
+ * push_back followed by a full sort and a scan for the id:
+ * insert [sizes...], by default 1000, 10000 and 100000
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/todo_list.h"
+
+using namespace p2d;
+using namespace std;
+
+namespace {
+    template <typename F>
+    double time_us(F &&fn) {
+        const auto start = chrono::steady_clock::now();
+        fn();
+        return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    }
+
+    todo::time_pt hours(long count) {
+        return todo::time_pt {} + chrono::hours { count };
+    }
+
+    // Fewer inserts into the larger lists, where the old insert is slow
+    int inserts_for(size_t size) {
+        return size >= 100'000 ? 200 : 1'000;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+        sizes.push_back(strtoul(argv[i], nullptr, 10));
+    }
+    if (sizes.empty()) {
+        sizes = { 1'000, 10'000, 100'000 };
+    }
+
+    cout << "average cost of one insert of a random deadline, in us\n"
+         << "size\tinserts\tsort+scan\tadd\n";
+
+    for (size_t size : sizes) {
+        const int inserts = inserts_for(size);
+        atomic<size_t> sink = 0; // keeps results from being optimized away
+
+        // The insert before: append, sort the whole list, find the id
+        mt19937 gen { 1 };
+        vector<todo> plain;
+        plain.reserve(size + inserts);
+        for (size_t i = 0; i < size; i++) {
+            plain.emplace_back(todo_ids().next(), "task " + to_string(gen() % 100'000), "", hours(gen() % 100'000));
+        }
+        rng::sort(plain, ordering_of<todo_order::deadline> {});
+        const double before = time_us([&] {
+            for (int i = 0; i < inserts; i++) {
+                const todo_id id = todo_ids().next();
+                plain.emplace_back(id, "new " + to_string(i), "", hours(gen() % 100'000));
+                rng::sort(plain, ordering_of<todo_order::deadline> {});
+                sink += distance(begin(plain), rng::find(plain, id, &todo::get_id));
+            }
+        }) / inserts;
+
+        // The same todos through todo_list, which inserts by binary search
+        gen = mt19937 { 1 };
+        todo_list list { "bench" };
+        list.begin_batch();
+        for (size_t i = 0; i < size; i++) {
+            list.add("task " + to_string(gen() % 100'000), "", hours(gen() % 100'000));
+        }
+        list.end_batch();
+        const double after = time_us([&] {
+            for (int i = 0; i < inserts; i++) {
+                sink += list.add("new " + to_string(i), "", hours(gen() % 100'000));
+            }
+        }) / inserts;
+
+        cout << size << '\t' << inserts << '\t' << before << '\t' << after << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+/**
+ *
+ * keystrokes.cpp
+ *
+ * Bytes the ncurses UI writes to the terminal per key, and the time to the
+ * first of them, with ./p2d on a 120x24 pty: keystrokes [todos], by default
+ * a list of 61 todos among 8 lists. Runs in a new HOME that is removed
+ * afterwards, so no data of the user is read or written.
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <poll.h>
+#include <pty.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr unsigned short rows = 24, cols = 120;
+    constexpr int other_lists = 7, other_todos = 3;
+    // A redraw is over once the terminal has been quiet this long
+    constexpr int quiet_ms = 100;
+    constexpr int prompt_ms = 10'000;
+
+    // Keys as an xterm in keypad mode sends them
+    constexpr string_view up = "\033OA", down = "\033OB", page_up = "\033[5~", page_down = "\033[6~",
+        esc = "\033", enter = "\n";
+
+    struct step {
+        string_view name;
+        string_view key;
+        int presses;
+    };
+
+    // From the lists into the long one and back, then through the agenda.
+    // Esc is taken only after the 30 ms escape delay of the UI.
+    constexpr step steps[] = {
+        { "Down, lists", down, other_lists },
+        { "Up, lists", up, other_lists },
+        { "entering a list", enter, 1 },
+        { "Down, todos", down, 30 },
+        { "Up, todos", up, 30 },
+        { "PageDown, todos", page_down, 5 },
+        { "PageUp, todos", page_up, 5 },
+        { "v, mark", "v", 10 },
+        { "Esc, back to lists", esc, 1 },
+        { "g, agenda", "g", 1 },
+        { "Down, agenda", down, 30 },
+        { "Esc, back to lists", esc, 1 },
+    };
+
+    // ./p2d on a new pty, its output read through fd
+    struct terminal {
+        int fd = -1;
+        pid_t pid = -1;
+
+        terminal() {
+            winsize size {};
+            size.ws_row = rows;
+            size.ws_col = cols;
+            pid = forkpty(&fd, nullptr, nullptr, &size);
+            if (pid < 0)
+                throw runtime_error { "forkpty failed" };
+            if (pid == 0) {
+                execl("./p2d", "p2d", nullptr);
+                _exit(127);
+            }
+        }
+
+        ~terminal() {
+            ::close(fd);
+            waitpid(pid, nullptr, 0);
+        }
+
+        void send(string_view keys) {
+            if (write(fd, keys.data(), keys.size()) != static_cast<ssize_t>(keys.size()))
+                throw runtime_error { "write to the pty failed" };
+        }
+
+        // Everything written until quiet_ms pass without output; first_us is
+        // set to the time the first byte took, if any came
+        size_t drain(double *first_us = nullptr) {
+            const auto start = chrono::steady_clock::now();
+            size_t bytes = 0;
+            char buf[4096];
+            pollfd p { fd, POLLIN, 0 };
+            while (poll(&p, 1, quiet_ms) > 0) {
+                const ssize_t n = read(fd, buf, sizeof buf);
+                if (n <= 0)
+                    break; // EIO once p2d has exited
+                if (bytes == 0 && first_us)
+                    *first_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+                bytes += n;
+            }
+            return bytes;
+        }
+
+        // Reads until text is shown, for the prompts before the UI is up
+        void expect(string_view text) {
+            string seen;
+            char buf[4096];
+            pollfd p { fd, POLLIN, 0 };
+            while (seen.find(text) == string::npos) {
+                if (poll(&p, 1, prompt_ms) <= 0)
+                    throw runtime_error { format("p2d never showed \"{}\"", text) };
+                const ssize_t n = read(fd, buf, sizeof buf);
+                if (n <= 0)
+                    throw runtime_error { format("p2d exited before \"{}\"", text) };
+                seen.append(buf, n);
+            }
+        }
+    };
+
+    // A user registered through the login prompts, as one would by hand
+    void register_user() {
+        constexpr pair<string_view, string_view> answers[] = {
+            { "ID (or", "new\n" }, { "New ID", "bench\n" }, { "Password", "bench\n" },
+            { "name", "Bench\n" }, { "email", "bench@example.com\n" },
+        };
+        terminal term;
+        for (auto [prompt, answer] : answers) {
+            term.expect(prompt);
+            term.send(answer);
+        }
+        term.expect("Todo Lists");
+        term.drain();
+        term.send(esc);
+        term.drain();
+    }
+
+    // The long list first, so it is the one selected on start
+    void add_todos(size_t count) {
+        FILE *batch = popen("./p2d batch > /dev/null", "w");
+        if (!batch)
+            throw runtime_error { "could not run ./p2d batch" };
+        auto add = [&](string_view list, size_t i) {
+            fprintf(batch, "add \"%.*s\" \"task %zu\" --due \"2030-01-%02zu %02zu:00:00\"\n",
+                static_cast<int>(list.size()), list.data(), i, 1 + i / 24 % 28, i % 24);
+        };
+        for (size_t i = 0; i < count; i++) {
+            add("bench", i);
+        }
+        for (int l = 0; l < other_lists; l++) {
+            for (int i = 0; i < other_todos; i++) {
+                add(format("list {}", l + 2), i);
+            }
+        }
+        if (pclose(batch) != 0)
+            throw runtime_error { "./p2d batch failed" };
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 61;
+
+    char dir[] = "/tmp/p2d-keystrokes.XXXXXX";
+    if (!mkdtemp(dir)) {
+        cerr << "could not make a home directory\n";
+        return 1;
+    }
+    setenv("HOME", dir, 1);
+    setenv("TERM", "xterm", 1);
+    setenv("P2D_KDF_ITERATIONS", "1000", 1); // only the one login, not timed
+
+    int status = 0;
+    try {
+        register_user();
+        add_todos(count);
+
+        terminal term;
+        term.drain(); // the lists, drawn in full once
+
+        cout << format("{}x{} pty, a list of {} todos among {} lists\n", cols, rows, count, other_lists + 1)
+             << "key\tpresses\tbytes/key\tus to first byte\n";
+        for (const step &s : steps) {
+            size_t bytes = 0;
+            double first = 0;
+            for (int i = 0; i < s.presses; i++) {
+                double us = 0;
+                term.send(s.key);
+                bytes += term.drain(&us);
+                first += us;
+            }
+            cout << s.name << '\t' << s.presses << '\t' << bytes / s.presses << '\t'
+                 << static_cast<long>(first / s.presses) << '\n';
+        }
+        term.send(esc);
+        term.drain();
+    } catch (const runtime_error &e) {
+        cerr << e.what() << '\n';
+        status = 1;
+    }
+
+    fs::remove_all(dir);
+    return status;
+}
@@ -0,0 +1,80 @@
+/**
+ *
+ * logins.cpp
+ *
+ * Logins per second through authenticator::verify(span) at each password
+ * cost, with one thread and with one per core: logins [iterations...], by
+ * default 1000, 10000, 100000 and password::default_iterations
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/authenticator.h"
+
+using namespace p2d;
+using namespace std;
+
+namespace {
+    constexpr int user_count = 8;
+    // Enough derivations at every cost for about a second on one core
+    constexpr uint64_t work = 2'000'000;
+}
+
+int main(int argc, char *argv[]) {
+    vector<uint32_t> costs;
+    for (int i = 1; i < argc; i++) {
+        costs.push_back(strtoul(argv[i], nullptr, 10));
+    }
+    if (costs.empty()) {
+        costs = { 1'000, 10'000, 100'000, password::default_iterations };
+    }
+
+    vector<size_t> threads { 1 };
+    if (thread::hardware_concurrency() > 1) {
+        threads.push_back(thread::hardware_concurrency());
+    }
+
+    cout << "cores " << thread::hardware_concurrency() << ", logins per second\n"
+         << "iterations\tthreads\tattempts\tlogins/s\n";
+
+    for (uint32_t cost : costs) {
+        // Stored at the cost being measured; half the attempts are wrong
+        user_list users;
+        for (int i = 0; i < user_count; i++) {
+            users.add(user { "name", "mail@example.com", "user" + to_string(i),
+                password { "secret" + to_string(i), cost } });
+        }
+        vector<string> ids, passwords;
+        for (int i = 0; i < user_count; i++) {
+            ids.push_back("user" + to_string(i));
+            passwords.push_back("secret" + to_string(i % 2 ? i : i + 1));
+        }
+
+        for (size_t n : threads) {
+            task_pool pool { n };
+            const authenticator auth { users, pool, cost };
+
+            vector<login_attempt> attempts(max<uint64_t>(n * 2, work / cost));
+            for (size_t i = 0; i < attempts.size(); i++) {
+                attempts[i] = { ids[i % user_count], passwords[i % user_count] };
+            }
+
+            const auto start = chrono::steady_clock::now();
+            const auto results = auth.verify(attempts);
+            const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            cout << cost << '\t' << n << '\t' << results.size() << '\t' << results.size() / seconds << '\n';
+        }
+    }
+
+    return 0;
+}
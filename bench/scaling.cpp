@@ -0,0 +1,123 @@
+/**
+ *
+ * scaling.cpp
+ *
+ * Times the parallel whole-store operations on synthetic stores, once per
+ * thread count: scaling [threads...], by default 1, 2, 4, ... up to the
+ * number of cores
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/snapshot.h"
+#include "../include/task_pool.h"
+#include "../include/todo_list.h"
+
+using namespace p2d;
+using namespace std;
+
+namespace {
+    constexpr int many_lists = 100;
+    constexpr int many_size = 10'000;
+    constexpr int one_size = 1'000'000;
+    constexpr int rounds = 20;
+
+    template <typename F>
+    double time_ms(F &&fn) {
+        const auto start = chrono::steady_clock::now();
+        fn();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    todo::time_pt hours(long count) {
+        return todo::time_pt {} + chrono::hours { count };
+    }
+
+    // The same todos on every call, left in batch mode if sorted is false
+    vector<todo_list> make_store(int lists, int size, bool sorted) {
+        mt19937 rng { 1 };
+        vector<todo_list> store;
+        store.reserve(lists);
+        for (int i = 0; i < lists; i++) {
+            todo_list &list = store.emplace_back("list " + to_string(i));
+            list.begin_batch();
+            for (int j = 0; j < size; j++) {
+                list.add("task " + to_string(rng() % 100'000), "word" + to_string(rng() % 5'000), hours(rng() % 100'000));
+            }
+            if (sorted) {
+                list.end_batch();
+            }
+        }
+        return store;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    vector<size_t> threads;
+    for (int i = 1; i < argc; i++) {
+        threads.push_back(strtoul(argv[i], nullptr, 10));
+    }
+    if (threads.empty()) {
+        for (size_t n = 1; n < thread::hardware_concurrency(); n *= 2) {
+            threads.push_back(n);
+        }
+        threads.push_back(max(1u, thread::hardware_concurrency()));
+    }
+
+    const vector<todo_list> many = make_store(many_lists, many_size, true);
+    const vector<todo_list> one = make_store(1, one_size, true);
+    const todo_filter filter { .due_until = hours(50'000), .completed = false };
+
+    // Hot columns are built by the first count, outside the timings
+    for (const auto &list : many) {
+        (void)list.count(filter);
+    }
+    (void)one.front().count(filter);
+
+    cout << "cores " << thread::hardware_concurrency() << ", " << many_lists << " lists of " << many_size
+         << " todos or one of " << one_size << ", times in ms\n"
+         << "threads\tcount many\tcount one\tencode\tend_batch\tfirst search\n";
+
+    for (size_t n : threads) {
+        task_pool pool { n };
+        atomic<size_t> sink = 0; // keeps results from being optimized away
+
+        const double count_many = time_ms([&] {
+            for (int r = 0; r < rounds; r++) {
+                pool.for_each(many.size(), [&](size_t i) { sink += many[i].count(filter, pool); });
+            }
+        }) / rounds;
+        const double count_one = time_ms([&] {
+            for (int r = 0; r < rounds; r++) {
+                sink += one.front().count(filter, pool);
+            }
+        }) / rounds;
+        const double encode = time_ms([&] {
+            pool.for_each(many.size(), [&](size_t i) { sink += snapshot::encode(span { &many[i], 1 }, 1).size(); });
+        });
+
+        // As after an import: every list in batch mode, then searched once
+        vector<todo_list> fresh = make_store(many_lists, many_size, false);
+        const double end_batch = time_ms([&] {
+            pool.for_each(fresh.size(), [&](size_t i) { fresh[i].end_batch(); });
+        });
+        const double search = time_ms([&] {
+            pool.for_each(fresh.size(), [&](size_t i) { sink += fresh[i].search("word123").size(); });
+        });
+
+        cout << n << '\t' << count_many << '\t' << count_one << '\t' << encode << '\t' << end_batch << '\t' << search << '\n';
+    }
+
+    return 0;
+}
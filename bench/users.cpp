@@ -0,0 +1,170 @@
+/**
+ *
+ * users.cpp
+ *
+ * Checks the lookups of user_list against brute force over its users, on
+ * a fresh directory, after removals and after a serialize round trip, then
+ * times them against the linear scan they replaced: users [count], by
+ * default 100000. Exits with 1 if any lookup disagrees.
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include "../include/user_list.h"
+
+using namespace p2d;
+using namespace std;
+
+namespace {
+    constexpr int queries = 100'000;
+    constexpr int scans = 100;
+    constexpr size_t name_limit = 10;
+
+    template <typename F>
+    double time_us(int count, F &&fn) {
+        const auto start = chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            fn(i);
+        }
+        return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / count;
+    }
+
+    // Names and emails repeat, so the secondary indexes hold equal keys
+    string id_of(size_t i) {
+        return "user" + to_string(i);
+    }
+
+    string name_of(size_t i) {
+        constexpr string_view first[] = { "ann", "bob", "cho", "dana", "eun", "fay", "gil", "hana" };
+        return string { first[i % size(first)] } + to_string(i % 997);
+    }
+
+    string email_of(size_t i) {
+        return "mail" + to_string(i % 50'021) + "@example.com";
+    }
+
+    vector<string> ids_of(const vector<const user *> &found) {
+        vector<string> ids;
+        for (const user *u : found) {
+            ids.emplace_back(u->get_id());
+        }
+        return ids;
+    }
+
+    vector<string> names_of(const vector<const user *> &found) {
+        vector<string> names;
+        for (const user *u : found) {
+            names.emplace_back(u->get_name());
+        }
+        return names;
+    }
+
+    // Every lookup against a scan of get_users(); prints the first
+    // disagreement and returns false
+    bool check(const user_list &users, size_t count, const string &stage) {
+        const auto &all = users.get_users();
+        mt19937 gen { 2 };
+        for (int q = 0; q < 500; q++) {
+            const size_t i = gen() % (count + count / 10); // some ids were never added
+
+            const string id = id_of(i);
+            const bool there = any_of(begin(all), end(all), [&](const user &u) { return u.get_id() == id; });
+            if (users.contains(id) != there || (users.find(id) != end(all)) != there) {
+                cout << stage << ": contains(\"" << id << "\") is wrong\n";
+                return false;
+            }
+
+            const string email = email_of(i);
+            vector<string> by_email;
+            for (const user &u : all) { // in id order already
+                if (u.get_email() == email)
+                    by_email.emplace_back(u.get_id());
+            }
+            if (ids_of(users.find_by_email(email)) != by_email) {
+                cout << stage << ": find_by_email(\"" << email << "\") is wrong\n";
+                return false;
+            }
+
+            const string prefix = name_of(i).substr(0, 1 + gen() % 4);
+            vector<string> by_name;
+            for (const user &u : all) {
+                if (u.get_name().starts_with(prefix))
+                    by_name.emplace_back(u.get_name());
+            }
+            ranges::sort(by_name);
+            by_name.resize(min(by_name.size(), name_limit));
+            if (names_of(users.find_by_name(prefix, name_limit)) != by_name) {
+                cout << stage << ": find_by_name(\"" << prefix << "\") is wrong\n";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100'000;
+
+    user_list users;
+    for (size_t i = 0; i < count; i++) {
+        users.add(user { name_of(i), email_of(i), id_of(i), password {} });
+    }
+    if (!check(users, count, "fresh"))
+        return 1;
+
+    mt19937 gen { 1 };
+    for (size_t i = 0; i < count / 10; i++) {
+        users.remove(id_of(gen() % count));
+    }
+    if (!check(users, count, "after removals"))
+        return 1;
+
+    stringstream archive;
+    {
+        boost::archive::binary_oarchive oa { archive };
+        oa << users;
+    }
+    user_list loaded;
+    {
+        boost::archive::binary_iarchive ia { archive };
+        ia >> loaded;
+    }
+    if (loaded.size() != users.size() || !check(loaded, count, "after a round trip"))
+        return 1;
+    cout << "lookups agree with brute force on " << count << " users\n";
+
+    atomic<size_t> sink = 0; // keeps results from being optimized away
+    const auto &all = loaded.get_users();
+    // The lookup before: a linear find_if copying each id into a string
+    const double scan = time_us(scans, [&](int) {
+        const string id = id_of(gen() % count);
+        sink += find_if(begin(all), end(all), [&](const user &u) { return string { u.get_id() } == id; }) != end(all);
+    });
+    const double hit = time_us(queries, [&](int q) { sink += loaded.contains(id_of(q % count)); });
+    const double miss = time_us(queries, [&](int q) { sink += loaded.contains(id_of(count + q)); });
+    const double email = time_us(queries, [&](int q) { sink += loaded.find_by_email(email_of(q)).size(); });
+    const double name = time_us(queries, [&](int q) { sink += loaded.find_by_name(name_of(q), name_limit).size(); });
+
+    cout << "average per lookup, in us, ids built outside the index included\n"
+         << "contains, linear scan with string copies\t" << scan << '\n'
+         << "contains, indexed hit\t" << hit << '\n'
+         << "contains, indexed miss\t" << miss << '\n'
+         << "find_by_email\t" << email << '\n'
+         << "find_by_name, up to " << name_limit << "\t" << name << '\n';
+
+    return 0;
+}
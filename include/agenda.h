@@ -0,0 +1,65 @@
+/**
+ *
+ * agenda.h
+ *
+ * Todos of every list in one deadline order
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _AGENDA_H_
+#define _AGENDA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "todo_store.h"
+
+namespace p2d {
+// One row of the agenda. It copies what it shows, so the list it came
+// from may be evicted.
+struct agenda_row {
+    std::size_t list = 0; // index of the list the todo is in
+    todo_id id = 0;
+    todo::time_pt deadline;
+    std::string title;
+    bool found = false; // see agenda::operator[]
+};
+
+// The open todos of every list that have a deadline, earliest first. Rows
+// are merged lazily from the store's deadline index, which covers lists
+// that are not loaded, so a row costs O(log n) and only the rows asked for
+// are merged. A list is loaded only once one of its rows is asked for, and
+// the store is trimmed right after.
+class agenda {
+public:
+    // settled: as for todo_store::trim()
+    agenda(todo_store &store, std::uint64_t settled);
+
+    // Merges up to pos if it has not been reached yet. pos < size(). The
+    // row is not found if its todo was gone when its list was loaded: the
+    // index is saved after the shards, so a crash can leave it older. The
+    // load brings the index up to date for the next agenda.
+    [[nodiscard]] const agenda_row &operator[](std::size_t pos);
+
+    // Todos in the index when the agenda was made, merged or not
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] bool empty() const;
+
+private:
+    todo_store &store;
+    std::uint64_t settled;
+    std::size_t total;
+    std::unordered_map<std::uint64_t, std::size_t> lists; // shard id -> index
+
+    std::vector<agenda_row> rows; // merged so far
+    std::optional<due_todo> last; // the entry of the last row
+};
+}
+
+#endif
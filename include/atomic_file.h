@@ -0,0 +1,69 @@
+/**
+ *
+ * atomic_file.h
+ *
+ * Crash-safe replacement of a file's contents
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _ATOMIC_FILE_H_
+#define _ATOMIC_FILE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <streambuf>
+#include <string_view>
+#include <vector>
+
+namespace p2d {
+// Writes go to "<path>.tmp" through a fixed-size buffer. commit() fsyncs
+// the data, renames it over path and fsyncs the directory, so readers see
+// either the old or the new contents, never a mix. Dropping the object
+// without commit() discards the temporary file.
+//
+// It is also a streambuf, so archives and ostreams can write through the
+// same bounded buffer without building the contents in memory first.
+class atomic_file : public std::streambuf {
+public:
+    atomic_file(const std::filesystem::path &path);
+    ~atomic_file() override;
+
+    // Disable copy semantics
+    atomic_file(const atomic_file &other) = delete;
+    atomic_file &operator=(const atomic_file &other) = delete;
+
+    void write(const void *data, std::size_t size);
+    void write(std::string_view str);
+
+    template <typename T>
+    void write_record(const T &record) {
+        write(&record, sizeof(T));
+    }
+
+    void commit();
+
+    [[nodiscard]] std::uint64_t bytes_written() const;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *data, std::streamsize size) override;
+    int sync() override;
+
+private:
+    std::filesystem::path path;
+    std::filesystem::path temp;
+    int fd = -1;
+
+    std::vector<char> buffer;
+    std::uint64_t written = 0;
+
+    static constexpr std::size_t buffer_size = 64 << 10;
+
+    void flush();
+    void write_fd(const char *data, std::size_t size);
+};
+}
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ *
+ * authenticator.h
+ *
+ * Checks passwords of the users in a user_list
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _AUTHENTICATOR_H_
+#define _AUTHENTICATOR_H_
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "task_pool.h"
+#include "user_list.h"
+
+namespace p2d {
+struct login_attempt {
+    std::string_view id;
+    std::string_view password;
+};
+
+// Every check costs one key derivation, at the cost the password was
+// stored with, whether or not the id exists, so that the time taken does
+// not tell which ids do. New passwords are stored at this authenticator's
+// cost; needs_rehash() finds the ones stored at another.
+class authenticator {
+public:
+    authenticator(const user_list &users, task_pool &pool,
+        std::uint32_t iterations = password::default_iterations);
+
+    // Disable copy semantics
+    authenticator(const authenticator &other) = delete;
+    authenticator &operator=(const authenticator &other) = delete;
+
+    [[nodiscard]] bool verify(std::string_view id, std::string_view attempt) const;
+    // Checks every attempt on the pool threads. The result holds 1 for
+    // each attempt that matched, in the order of attempts.
+    [[nodiscard]] std::vector<std::uint8_t> verify(std::span<const login_attempt> attempts) const;
+
+    [[nodiscard]] password hash(std::string_view pw) const;
+    [[nodiscard]] bool needs_rehash(const user &u) const;
+    [[nodiscard]] std::uint32_t get_iterations() const;
+
+private:
+    const user_list &users;
+    task_pool &pool;
+    std::uint32_t iterations;
+
+    // Checked against for unknown ids, derived on first use
+    mutable password dummy;
+    mutable std::once_flag dummy_made;
+};
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ *
+ * checkpointer.h
+ *
+ * Background writer for snapshots and journal compaction
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _CHECKPOINTER_H_
+#define _CHECKPOINTER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace p2d {
+// When the session hands a checkpoint to the background thread
+struct checkpoint_options {
+    std::chrono::seconds interval { 30 };  // at least this often while edits keep coming
+    std::uint64_t journal_bytes = 1 << 20; // or once the journal grows past this
+};
+
+// Everything the UI thread captured, so that the background thread never
+// has to look at live data
+struct checkpoint_job {
+    std::uint64_t id = 0;
+    std::vector<std::pair<std::filesystem::path, std::string>> files; // replaced in order
+    std::vector<std::filesystem::path> obsolete; // removed once all files are in place
+    std::function<void()> then; // run last, on the thread that wrote the job
+};
+
+struct checkpoint_metrics {
+    std::uint64_t completed = 0;
+    std::uint64_t failed = 0;
+    std::chrono::microseconds last_duration { 0 };
+    std::chrono::microseconds total_duration { 0 };
+    std::uint64_t last_bytes = 0;
+    std::uint64_t total_bytes = 0;
+};
+
+class checkpointer {
+public:
+    checkpointer();
+    ~checkpointer();
+
+    // Disable copy semantics
+    checkpointer(const checkpointer &other) = delete;
+    checkpointer &operator=(const checkpointer &other) = delete;
+
+    void submit(checkpoint_job &&job);
+
+    // Finishes queued jobs and joins the thread
+    void stop();
+
+    [[nodiscard]] bool busy() const;
+    // True once a job failed; later jobs are dropped so that no journal
+    // segment is removed before the data it holds reached disk
+    [[nodiscard]] bool failed() const;
+    // Id of the newest job whose files are all on disk
+    [[nodiscard]] std::uint64_t settled() const;
+    [[nodiscard]] checkpoint_metrics metrics() const;
+
+    // Writes a job on the calling thread. Returns the bytes written.
+    static std::uint64_t run(const checkpoint_job &job);
+
+private:
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<checkpoint_job> queue;
+
+    bool stopping = false;
+    bool running = false;
+    bool has_failed = false;
+    std::uint64_t last_settled = 0;
+    checkpoint_metrics stats;
+
+    std::thread worker; // last, so it starts after everything it reads
+
+    void loop();
+};
+}
+
+#endif
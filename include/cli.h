@@ -0,0 +1,71 @@
+/**
+ *
+ * cli.h
+ *
+ * Headless command line interface for p2d
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _CLI_H_
+#define _CLI_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "session.h"
+
+namespace p2d {
+// Runs one subcommand against a session without any ui_manager:
+//   p2d add <list> <title> [-d description] [--due "YYYY-MM-DD HH:MM:SS"]
+//   p2d done <list> <id>...
+//   p2d ls [list] [--due-before "YYYY-MM-DD HH:MM:SS"]
+//   p2d rm <list> [id...] [--done]
+//   p2d mv <list> <to> <id>...
+//   p2d find <text> [list...]    (substring of title or description)
+//   p2d due [--hours N] [--next]
+//   p2d count [--open] [--due-before "YYYY-MM-DD HH:MM:SS"] [list...]
+//   p2d export [-f jsonl|csv] [-o file] [list...]
+//   p2d import [-f jsonl|csv] [file]
+//   p2d batch             (the same commands, one per line, from stdin)
+// A list is addressed by its title and created on the first add.
+class cli {
+public:
+    cli(session &sess, std::ostream &out = std::cout, std::ostream &err = std::cerr);
+
+    // Returns the exit status: 0 on success, 1 if a command failed or the
+    // session could not be saved when closed afterwards, 2 on a usage error
+    int run(int argc, char *argv[]);
+    int run_batch(std::istream &in);
+
+private:
+    session &sess;
+    std::ostream &out;
+    std::ostream &err;
+
+    using args = std::vector<std::string>;
+
+    int dispatch(const args &command);
+
+    void add(const args &command);
+    void done(const args &command);
+    void ls(const args &command);
+    void rm(const args &command);
+    void mv(const args &command);
+    void find(const args &command);
+    void due(const args &command);
+    void count(const args &command);
+    void export_todos(const args &command);
+    void import_todos(const args &command);
+
+    void print_usage() const;
+    [[nodiscard]] std::size_t require_list(const std::string &title) const;
+    [[nodiscard]] std::vector<std::size_t> require_lists(const std::vector<std::string> &titles) const;
+    // Checks every id up front, so a bulk command changes all or nothing
+    void require_todos(std::size_t list, const std::vector<todo_id> &ids);
+};
+}
+
+#endif
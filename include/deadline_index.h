@@ -0,0 +1,89 @@
+/**
+ *
+ * deadline_index.h
+ *
+ * Deadlines of the open todos of every list
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _DEADLINE_INDEX_H_
+#define _DEADLINE_INDEX_H_
+
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "todo_list.h"
+
+namespace p2d {
+// One incomplete todo with a deadline, wherever its list is
+struct due_todo {
+    todo::time_pt deadline;
+    std::uint64_t list; // shard id
+    todo_id id;
+
+    auto operator<=>(const due_todo &rhs) const = default;
+};
+
+// Every incomplete todo that has a deadline, across all lists, ordered by
+// deadline. Completed todos and those without a deadline are left out, so
+// a range of the tree is exactly what is due in it.
+class deadline_index {
+public:
+    // Ignores todos that do not belong in the index
+    void add(std::uint64_t list, const todo &t);
+    void add(const due_todo &due);
+    void remove(std::uint64_t list, todo_id id);
+
+    // Replaces whatever the index holds for list with its current todos
+    void assign(std::uint64_t list, const todo_list &todos);
+    void remove_list(std::uint64_t list);
+    void clear();
+
+    // Due in [from, until), earliest first. O(log n + k).
+    [[nodiscard]] std::vector<due_todo> due_between(todo::time_pt from, todo::time_pt until) const;
+    // The first todo due at or after from. O(log n).
+    [[nodiscard]] std::optional<due_todo> next_due(todo::time_pt from = todo::time_pt::min()) const;
+    // The entry right after due, which need not be in the index. O(log n).
+    [[nodiscard]] std::optional<due_todo> after(const due_todo &due) const;
+
+    // Everything the index holds for list, earliest first
+    [[nodiscard]] std::vector<due_todo> of_list(std::uint64_t list) const;
+    // The earliest deadline in list, or time_pt::max() if none. O(1).
+    [[nodiscard]] todo::time_pt earliest(std::uint64_t list) const;
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    using tree = std::set<due_todo>;
+
+    struct list_dues {
+        std::unordered_map<todo_id, tree::iterator> nodes;
+        std::multiset<todo::time_pt> deadlines;
+    };
+
+    tree by_deadline;
+    // list -> id -> its node, so single todos and whole lists come out
+    // fast, and the list's deadlines on their own for earliest()
+    std::unordered_map<std::uint64_t, list_dues> by_list;
+};
+
+// Keeps a deadline_index in sync with one list it watches
+class deadline_watcher : public todo_watcher {
+public:
+    deadline_watcher(deadline_index &index, std::uint64_t list);
+
+    void added(const todo &t) override;
+    void removed(const todo &t) override;
+
+private:
+    deadline_index &index;
+    std::uint64_t list;
+};
+}
+
+#endif
@@ -0,0 +1,162 @@
+/**
+ *
+ * journal.h
+ *
+ * Append-only mutation journal for todo lists
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "todo_list.h"
+
+namespace p2d {
+// Every mutation made from session::run() is appended here as one small
+// record, so the cost of persisting an edit does not depend on the number
+// of todos. On startup the records newer than the snapshot are replayed.
+// Lists are addressed by their shard id, which never changes or gets reused.
+//
+// Records go to numbered segment files "<base>.<n>". A checkpoint rotates
+// to a new segment and removes the sealed ones once its snapshot is on
+// disk, so appending never waits for compaction. The checkpointer opens
+// the next segment ahead of time, so rotating only swaps descriptors.
+//
+// Appends are plain write()s without fsync, landing in the page cache; a
+// record costs a few microseconds however large the lists are.
+class journal {
+public:
+    enum class op : std::uint8_t {
+        create_list = 1,
+        remove_list,
+        add_todo,
+        remove_todo,
+        mark_completed,
+        mark_incomplete,
+        set_title,
+        set_description,
+        set_deadline,
+        remove_todos,
+        set_completed,
+        move_todos,
+    };
+
+    struct record {
+        std::uint64_t lsn;
+        op type;
+        std::uint64_t list;
+        std::string_view payload;
+        std::size_t id_size = sizeof(todo_id); // 4 in segments older than todo_id
+    };
+
+    journal() = default;
+    ~journal();
+
+    // Disable copy semantics
+    journal(const journal &other) = delete;
+    journal &operator=(const journal &other) = delete;
+
+    // covered: last lsn already reflected on disk; numbering continues after it
+    void open(const std::filesystem::path &base, std::uint64_t covered);
+    void close();
+
+    // Hands every intact record to fn in order, then drops a torn tail.
+    // Returns the number of records read.
+    std::size_t replay(const std::function<void(const record &)> &fn);
+
+    // Applies a todo-level record to the list it addresses
+    static void apply(const record &r, todo_list &list);
+    // A move_todos record addresses the list the todos left; these give the
+    // list they went to and add them there
+    [[nodiscard]] static std::uint64_t move_target(const record &r);
+    static void apply_moved(const record &r, todo_list &list);
+    // Title carried by a create_list record
+    [[nodiscard]] static std::string_view list_title(const record &r);
+
+    // Starts a new segment and returns the number of the one it sealed.
+    // Opens it here unless prepare() already did.
+    std::uint64_t rotate();
+    // Opens segment number for a later rotate(). Safe to call from another
+    // thread while records are being appended.
+    void prepare(std::uint64_t number);
+    // Number of the segment currently appended to
+    [[nodiscard]] std::uint64_t segment() const;
+    // Forgets sealed segments up to upto and returns their paths, to be
+    // removed once a snapshot covers them
+    [[nodiscard]] std::vector<std::filesystem::path> release(std::uint64_t upto);
+
+    // Record writers, one per mutation
+    void create_list(std::uint64_t list, std::string_view title);
+    void remove_list(std::uint64_t list);
+    void add_todo(std::uint64_t list, const todo &t);
+    void remove_todo(std::uint64_t list, todo_id id);
+    void mark_completed(std::uint64_t list, todo_id id);
+    void mark_incomplete(std::uint64_t list, todo_id id);
+    void set_title(std::uint64_t list, todo_id id, std::string_view title);
+    void set_description(std::uint64_t list, todo_id id, std::string_view description);
+    void set_deadline(std::uint64_t list, todo_id id, const todo::time_pt &deadline);
+    // Bulk edits, one record however many todos they touch
+    void remove_todos(std::uint64_t list, const std::vector<todo_id> &ids);
+    void set_completed(std::uint64_t list, const std::vector<todo_id> &ids, bool completed);
+    // ids left from, and moved are the todos as added to to, new ids and all
+    void move_todos(std::uint64_t from, std::uint64_t to, const std::vector<todo_id> &ids, std::span<const todo> moved);
+
+    // lsn of the most recently written (or replayed) record
+    [[nodiscard]] std::uint64_t last_lsn() const;
+    // Bytes of records in the segment currently appended to
+    [[nodiscard]] std::uint64_t size() const;
+
+private:
+    std::filesystem::path base;
+    std::vector<std::uint64_t> segments; // not yet released, oldest first
+    std::uint64_t current = 0;
+
+    int fd = -1;
+    std::uint64_t next_lsn = 1;
+    std::uint64_t bytes = 0;
+
+    std::mutex spare_mtx; // guards the three below, set by prepare()
+    int spare_fd = -1;
+    std::uint64_t spare = 0;
+    std::uint64_t spare_bytes = 0;
+
+    // Segment layout: [segment_header][record]...
+    // Record layout:  [u32 body size][u32 checksum][body]
+    // Body layout:    [u64 lsn][u8 op][u64 list][payload]
+    static constexpr std::size_t frame_size = sizeof(std::uint32_t) * 2;
+
+    static constexpr char magic[4] = { 'P', '2', 'D', 'J' };
+    static constexpr std::uint32_t version = 2;
+
+    struct segment_header {
+        char magic[4];
+        std::uint32_t version;
+    };
+
+    // Returns false for a segment older than segment_header
+    bool open_segment(std::uint64_t number);
+    // Opens a segment for appending, giving a new one its header. Sets size
+    // to the bytes of records and current intact to whether it has the header.
+    [[nodiscard]] int open_file(std::uint64_t number, std::uint64_t &size, bool &intact) const;
+    std::size_t replay_segment(std::uint64_t number, const std::function<void(const record &)> &fn);
+    [[nodiscard]] std::filesystem::path segment_path(std::uint64_t number) const;
+
+    std::string begin_record(op type, std::uint64_t list);
+    void append(std::string &body);
+
+    static std::uint32_t checksum(std::string_view data);
+};
+}
+
+#endif
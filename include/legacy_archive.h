@@ -0,0 +1,41 @@
+/**
+ *
+ * legacy_archive.h
+ *
+ * Reader for todo.bin files written before the snapshot format
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _LEGACY_ARCHIVE_H_
+#define _LEGACY_ARCHIVE_H_
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include "todo_list.h"
+
+namespace p2d {
+// Those files are Boost binary archives of every list. From the first
+// journaled build on, the journal lsn they cover comes before the lists;
+// before it there is nothing in front. Neither layout says which it is, so
+// both are tried and the one that reads the whole file is taken.
+class legacy_archive {
+public:
+    // True if data starts like a Boost binary archive
+    [[nodiscard]] static bool matches(std::string_view data);
+
+    // Returns the journal lsn the file covers, 0 for the headerless layout.
+    // Todos get new ids: the old ones were only unique within their list.
+    // Lists and todos are allocated from the memory resource of lists.
+    static std::uint64_t load(std::string_view data, std::pmr::vector<todo_list> &lists);
+
+private:
+    static constexpr std::string_view signature = "serialization::archive";
+};
+}
+
+#endif
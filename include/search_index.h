@@ -0,0 +1,88 @@
+/**
+ *
+ * search_index.h
+ *
+ * Word and trigram index over todo titles and descriptions
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _SEARCH_INDEX_H_
+#define _SEARCH_INDEX_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "todo.h"
+
+namespace p2d {
+// Maps every word of a todo's title and description, ASCII case folded, to
+// the sorted ids of the todos containing it. A word is a run of letters,
+// digits and non-ASCII bytes, so Hangul stays in one piece. The distinct
+// words are in turn indexed by trigram, which finds the words containing a
+// piece of the query, and so the todos that may contain all of it.
+class search_index {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit search_index(const allocator_type &alloc = {});
+    search_index(search_index &&rhs) noexcept = default;
+    search_index(search_index &&rhs, const allocator_type &alloc);
+
+    search_index &operator=(search_index &&rhs) noexcept = default;
+
+    // remove() must see the same title and description add() did
+    void add(const todo &t);
+    void remove(const todo &t);
+    void clear();
+
+    // Pieces of the query shorter than this are not looked up
+    static constexpr std::size_t min_piece = 3;
+
+    // Sorted ids of the todos that may contain query, a superset of the
+    // matches. Nothing if no piece of query was long enough to look up, in
+    // which case every todo is a candidate.
+    [[nodiscard]] std::optional<std::vector<todo_id>> candidates(std::string_view query) const;
+
+    // Whether the candidates of query are all matches, as they are for a
+    // single word or piece of one
+    [[nodiscard]] static bool exact(std::string_view query);
+
+    [[nodiscard]] static std::string fold_case(std::string_view query);
+    // Whether t really contains the case folded query, ignoring ASCII case
+    [[nodiscard]] static bool matches(const todo &t, std::string_view folded);
+
+private:
+    using trigram = std::uint32_t;
+    using posting = std::pmr::vector<todo_id>;
+
+    struct word_hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view word) const {
+            return std::hash<std::string_view> {}(word);
+        }
+    };
+    using word_map = std::pmr::unordered_map<std::pmr::string, posting, word_hash, std::equal_to<>>;
+    using word_entry = word_map::value_type;
+
+    word_map words;
+    // trigram -> the words containing it, in no particular order
+    std::pmr::unordered_map<trigram, std::pmr::vector<const word_entry *>> word_grams;
+
+    void add_word(std::string_view word, todo_id id);
+    void remove_word(std::string_view word, todo_id id);
+    // Lists entry under each trigram of its word
+    void add_grams(const word_entry &entry);
+    // Sorted ids of the todos with a word containing piece
+    [[nodiscard]] std::vector<todo_id> containing(std::string_view piece) const;
+};
+}
+
+#endif
@@ -11,75 +11,169 @@
 #ifndef _SESSION_H_
 #define _SESSION_H_
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <streambuf>
 #include <string_view>
 #include <type_traits>
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 
-#include "todo_list.h"
+#include "checkpointer.h"
+#include "journal.h"
+#include "todo_store.h"
+#include "transfer.h"
 #include "ui_manager.h"
 #include "user_list.h"
 
 namespace p2d {
 template <typename T>
-concept SerializableData = std::is_same_v<T, user> || std::is_same_v<T, user_list> || std::is_same_v<T, std::vector<todo_list>>;
+concept SerializableData = std::is_same_v<T, user> || std::is_same_v<T, user_list>;
 
 class session {
 public:
-    session(ui_manager &ui);
+    session(ui_manager &ui, checkpoint_options options = {});
+    // Without a ui_manager, for the command line; run() is not available
+    explicit session(checkpoint_options options = {});
     ~session();
 
     void load_login();
     void load_user();
+    // Reads the logged-in user's partition, if anyone is logged in and it
+    // was not read yet
     void load_todo();
 
     void save_login();
     void save_user();
+    // Checkpoints synchronously on the calling thread
     void save_todo();
 
-    void run();
+    // Saves what changed and releases the todos. run() calls it on the way
+    // out; the command line once its commands are done. Unlike the
+    // destructor, which only releases, it throws if a file cannot be written.
+    void close();
 
-    [[nodiscard]] std::string serialize_login() const;
-    [[nodiscard]] std::string serialize_user() const;
-    [[nodiscard]] std::string serialize_todo() const;
+    void run();
 
-    void parse_binary_login(const std::string &data);
-    void parse_binary_user(const std::string &data);
-    void parse_binary_todo(const std::string &data);
+    // The headless operations need someone logged in, whose todos they see
+    [[nodiscard]] bool logged_in() const;
+
+    // Headless operations. Each one journals its change and loads only the
+    // shard of the list it addresses. Todos are addressed by id.
+    [[nodiscard]] const std::vector<list_info> &lists() const;
+    [[nodiscard]] std::optional<std::size_t> find_list(std::string_view title) const;
+    [[nodiscard]] const todo_list &open_list(std::size_t index);
+
+    // Open deadlines of every list, loaded or not, by shard id
+    [[nodiscard]] const deadline_index &deadlines() const;
+    [[nodiscard]] std::optional<std::size_t> find_shard(std::uint64_t shard) const;
+
+    std::size_t create_list(std::string_view title);
+    void remove_list(std::size_t index);
+
+    todo_id add_todo(std::size_t list,
+        std::string_view title,
+        std::string_view description,
+        const todo::time_pt &deadline);
+    bool complete_todo(std::size_t list, todo_id id);
+    bool remove_todo(std::size_t list, todo_id id);
+
+    // Bulk versions, one pass over the list and one journal record each.
+    // Ids not in the list are skipped. All return the number of todos changed.
+    std::size_t complete_todos(std::size_t list, const std::vector<todo_id> &ids, bool completed = true);
+    std::size_t remove_todos(std::size_t list, const std::vector<todo_id> &ids);
+    std::size_t remove_completed(std::size_t list);
+    // The todos keep their ids, which are unique across lists
+    std::size_t move_todos(std::size_t from, std::size_t to, const std::vector<todo_id> &ids);
+
+    // Both work on the given lists (all if empty), loading them a group at
+    // a time and spreading each group over the worker threads. Results come
+    // in the order of the lists.
+    [[nodiscard]] std::vector<std::vector<todo_id>> search(std::string_view query, const std::vector<std::size_t> &lists = {});
+    [[nodiscard]] std::vector<std::size_t> count_todos(const todo_filter &filter, const std::vector<std::size_t> &lists = {});
+
+    // Streams every todo of the given lists (all if empty) one list at a time
+    transfer_stats export_todos(todo_writer &out, const std::vector<std::size_t> &lists = {});
+    // Appends each row to its list, created if missing, as a new todo that
+    // keeps the row's id unless some list has it already. Lists are sorted
+    // once per batch rather than once per todo.
+    transfer_stats import_todos(todo_reader &in);
+
+    [[nodiscard]] checkpoint_metrics checkpoint_stats() const;
+
+    void serialize_login(std::streambuf &out) const;
+    void serialize_user(std::streambuf &out) const;
+
+    void parse_binary_login(std::streambuf &in);
+    void parse_binary_user(std::streambuf &in);
 
     [[maybe_unused]] static constexpr std::string_view app_name = "PeerTodo";
 
 private:
-    ui_manager &ui;
+    ui_manager *ui = nullptr;
 
     std::unique_ptr<user> current_user;
+    bool login_dirty = false;
     user_list all_users;
 
-    std::vector<todo_list> todo_lists;
+    // Each user's todos live in a directory of their own under user_dir
+    todo_store todo_lists;
     std::filesystem::path data_path;
+    bool todo_loaded = false;
+    int partition_lock = -1; // flock()ed while the todos are loaded
 
-    static constexpr std::string_view login_file = "login.bin";
-    static constexpr std::string_view user_file = "user.bin";
-    static constexpr std::string_view todo_file = "todo.bin";
+    journal todo_log;
 
-    [[nodiscard]] std::streamsize file_size(std::ifstream &fin) const;
+    checkpointer checkpoints;
+    checkpoint_options options;
+    std::chrono::steady_clock::time_point last_checkpoint;
+    std::uint64_t last_job = 0;
 
-    template <SerializableData T>
-    [[nodiscard]] static std::string serialize(const T &obj) {
-        std::ostringstream oss;
-        boost::archive::binary_oarchive oa { oss };
-        oa << obj;
-        return oss.str();
+    task_pool workers; // P2D_THREADS threads, or one per core
+
+    static constexpr std::string_view login_file = "login.bin";
+    static constexpr std::string_view user_file = "user.bin";
+    static constexpr std::string_view user_dir = "users";
+    static constexpr std::string_view todo_dir = "todo";
+    static constexpr std::string_view journal_file = "todo.journal";
+    static constexpr std::string_view legacy_file = "todo.bin"; // before shards
+    static constexpr std::size_t import_batch = 1 << 16;
+
+    [[nodiscard]] std::filesystem::path partition_path(std::string_view id) const;
+    // Moves todos saved before there were partitions into partition
+    void adopt_shared(const std::filesystem::path &partition);
+    // Fails if another process has the todos of partition loaded
+    void lock_partition(const std::filesystem::path &partition);
+    void unlock_partition();
+
+    // Shows the todos of every list in deadline order until closed
+    void run_agenda();
+
+    // Calls fn(i, list) for the i-th of lists, on the worker threads
+    template <typename F>
+    void for_each_list(const std::vector<std::size_t> &lists, F &&fn);
+    [[nodiscard]] std::vector<std::size_t> every_list(const std::vector<std::size_t> &lists) const;
+
+    // Hands a checkpoint to the background thread if a threshold was hit
+    void maybe_checkpoint();
+    [[nodiscard]] checkpoint_job capture_todo(bool everything);
+
+    // Archives read and write the streambuf directly, so the only extra
+    // memory is its buffer, however large the data is
+    template <SerializableData... T>
+    static void serialize(std::streambuf &out, const T &...objs) {
+        boost::archive::binary_oarchive oa { out };
+        (oa << ... << objs);
     }
 
-    template <SerializableData T>
-    static void parse_binary(T &obj, const std::string &data) {
-        std::istringstream iss { data };
-        boost::archive::binary_iarchive ia { iss };
-        ia >> obj;
+    template <SerializableData... T>
+    static void parse_binary(std::streambuf &in, T &...objs) {
+        boost::archive::binary_iarchive ia { in };
+        (ia >> ... >> objs);
     }
 };
 }
@@ -0,0 +1,94 @@
+/**
+ *
+ * snapshot.h
+ *
+ * Flat, memory-mapped on-disk format for todo lists
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "todo_list.h"
+
+namespace p2d {
+// Read-only mapping of a whole file
+class mapped_file {
+public:
+    mapped_file(const std::filesystem::path &path);
+    ~mapped_file();
+
+    // Disable copy semantics
+    mapped_file(const mapped_file &other) = delete;
+    mapped_file &operator=(const mapped_file &other) = delete;
+
+    [[nodiscard]] std::string_view data() const;
+
+private:
+    void *addr = nullptr;
+    std::size_t length = 0;
+};
+
+// File layout (version 1, native byte order):
+//   header   magic "P2DT", version, covered journal lsn, list count
+//   lists    one list_record per list
+//   todos    one todo_record per todo, grouped by list in stored order
+//   strings  list titles, todo titles and descriptions, back to back
+// Loading maps the file and leaves todo texts as views into the mapping.
+class snapshot {
+public:
+    static constexpr std::uint32_t version = 1;
+
+    // Returns the journal lsn the snapshot covers
+    // Lists and todos are allocated from the memory resource of lists.
+    // A Boost archive from before this format is read as well.
+    static std::uint64_t load(const std::filesystem::path &path, std::pmr::vector<todo_list> &lists);
+    static void save(const std::filesystem::path &path, std::span<const todo_list> lists, std::uint64_t lsn);
+    // Same bytes as save(), kept in memory to be written out later
+    [[nodiscard]] static std::string encode(std::span<const todo_list> lists, std::uint64_t lsn);
+
+private:
+    static constexpr char magic[4] = { 'P', '2', 'D', 'T' };
+
+    template <typename Sink>
+    static void write(Sink &out, std::span<const todo_list> lists, std::uint64_t lsn);
+
+    struct header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t lsn;
+        std::uint32_t list_count;
+        std::uint32_t reserved;
+    };
+
+    struct list_record {
+        std::uint64_t title_offset;
+        std::uint64_t first_todo;
+        std::uint32_t title_size;
+        std::uint32_t todo_count;
+    };
+
+    struct todo_record {
+        std::int64_t id; // a todo_id, whose top bit is always clear
+        std::int64_t created;
+        std::int64_t deadline;
+        std::uint64_t title_offset;
+        std::uint64_t description_offset;
+        std::uint32_t title_size;
+        std::uint32_t description_size;
+        std::uint8_t completed;
+        std::uint8_t reserved[7];
+    };
+};
+}
+
+#endif
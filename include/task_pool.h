@@ -0,0 +1,87 @@
+/**
+ *
+ * task_pool.h
+ *
+ * Worker threads that split work over lists or chunks of a list
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _TASK_POOL_H_
+#define _TASK_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace p2d {
+// Runs one parallel loop at a time on a fixed set of threads, the calling
+// thread included. Indexes are handed out one by one from a shared counter,
+// so a thread that finishes early takes the next one and uneven items even
+// out. A loop started from inside another runs inline on its thread.
+class task_pool {
+public:
+    // threads counts the calling thread; 0 means one per core
+    explicit task_pool(std::size_t threads = 0);
+    ~task_pool();
+
+    // Disable copy semantics
+    task_pool(const task_pool &other) = delete;
+    task_pool &operator=(const task_pool &other) = delete;
+
+    [[nodiscard]] std::size_t size() const;
+
+    // Calls fn(i) for every i in [0, n) and returns once all calls did.
+    // The first exception thrown is rethrown here; the indexes not handed
+    // out yet by then are skipped.
+    template <typename F>
+    void for_each(std::size_t n, F &&fn) {
+        using fn_type = std::remove_reference_t<F>;
+        run(n, [](void *ctx, std::size_t i) { (*static_cast<fn_type *>(ctx))(i); }, &fn);
+    }
+
+    // Calls fn(first, last) for chunks of [0, n) of at least grain items,
+    // a few per thread so that a slow chunk does not hold up the rest
+    template <typename F>
+    void for_each_chunk(std::size_t n, std::size_t grain, F &&fn) {
+        const std::size_t chunks = std::clamp<std::size_t>(n / std::max<std::size_t>(grain, 1), 1, size() * 4);
+        for_each(n == 0 ? 0 : chunks, [&](std::size_t c) {
+            fn(n * c / chunks, n * (c + 1) / chunks);
+        });
+    }
+
+private:
+    using task = void (*)(void *ctx, std::size_t i);
+
+    std::mutex mtx;
+    std::condition_variable wake; // a loop started, or the pool is stopping
+    std::condition_variable done; // the last worker left the loop
+
+    // The current loop; written under mtx before the workers are woken
+    task job = nullptr;
+    void *job_ctx = nullptr;
+    std::size_t job_size = 0;
+    std::atomic<std::size_t> next = 0;
+    std::uint64_t generation = 0;
+    std::size_t busy = 0; // workers that have not left the loop yet
+    std::exception_ptr error;
+    bool stopping = false;
+
+    std::vector<std::thread> workers; // last, so they start after everything they read
+
+    void run(std::size_t n, task fn, void *ctx);
+    // Takes indexes of the current loop until there are none left
+    void drain();
+    void loop();
+};
+}
+
+#endif
@@ -14,50 +14,102 @@
 #include <chrono>
 #include <compare>
 #include <iostream>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 
-#include <boost/serialization/access.hpp>
-#include <boost/serialization/binary_object.hpp>
-
+#include "todo_id.h"
 #include "user.h"
 
 namespace p2d {
 // Forward declaration
 class todo;
+class snapshot;
+// Orderings are stateless and defined inline below, so templates taking
+// them as a type compile every comparison down to a few loads
 namespace order {
     struct by_deadline {
-        bool operator()(const todo &lhs, const todo &rhs) const;
+        constexpr bool operator()(const todo &lhs, const todo &rhs) const;
     };
     struct by_created {
-        bool operator()(const todo &lhs, const todo &rhs) const;
+        constexpr bool operator()(const todo &lhs, const todo &rhs) const;
     };
     struct by_completed {
-        bool operator()(const todo &lhs, const todo &rhs) const;
+        constexpr bool operator()(const todo &lhs, const todo &rhs) const;
     };
     struct by_title {
-        bool operator()(const todo &lhs, const todo &rhs) const;
+        constexpr bool operator()(const todo &lhs, const todo &rhs) const;
+    };
+    struct by_id {
+        constexpr bool operator()(const todo &lhs, const todo &rhs) const;
+    };
+
+    // Compares by each ordering in turn, moving to the next only on a tie,
+    // e.g. then<by_deadline, by_title>
+    template <typename... Orders>
+    struct then {
+        constexpr bool operator()(const todo &lhs, const todo &rhs) const {
+            bool less = false;
+            // Stops at the first ordering that tells the two apart
+            (void)((Orders {}(lhs, rhs) ? (less = true) : Orders {}(rhs, lhs)) || ...);
+            return less;
+        }
     };
+
+    // Breaks the remaining ties by id, so no two todos compare equal and
+    // every sort gives the same result
+    template <typename... Orders>
+    using stable = then<Orders..., by_id>;
 }
 
+// String that borrows from a mapped snapshot until it is first edited
+class text {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    text() = default;
+    explicit text(const allocator_type &alloc);
+    text(std::string_view str, const allocator_type &alloc = {});
+    text(text &&rhs) noexcept = default;
+    text(text &&rhs, const allocator_type &alloc);
+
+    text &operator=(text &&rhs) = default;
+
+    [[nodiscard]] static text borrow(std::string_view mapped);
+
+    text &operator=(std::string_view str);
+    constexpr operator std::string_view() const;
+
+    [[nodiscard]] bool is_borrowed() const;
+
+private:
+    std::pmr::string owned;
+    std::string_view borrowed;
+    bool borrowing = false;
+};
+
 class todo {
-    using time_pt = std::chrono::time_point<std::chrono::system_clock>;
     friend class todo_list;
-    friend class boost::serialization::access;
+    friend class snapshot;
 
 public:
+    using time_pt = std::chrono::time_point<std::chrono::system_clock>;
+    // Lets pmr containers hand their memory resource down to the texts
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
     // Constructors
-    todo(int id,
+    todo(todo_id id,
         std::string_view title,
         std::string_view description,
         const time_pt &deadline);
-    todo(int id,
+    todo(todo_id id,
         std::string_view title,
         std::string_view description,
         const time_pt &created,
         const time_pt &deadline,
         const bool completed = false);
     todo(todo &&rhs) noexcept = default;
+    todo(todo &&rhs, const allocator_type &alloc);
 
     // Disable copy semantics
     todo(const todo &rhs) = delete;
@@ -69,12 +121,13 @@ public:
     // auto operator<=>(const todo &rhs) const;
 
     // Getters
-    [[nodiscard]] int get_id() const;
-    [[nodiscard]] const std::string &get_title() const;
-    [[nodiscard]] const std::string &get_description() const;
-    [[nodiscard]] const time_pt &get_created() const;
-    [[nodiscard]] const time_pt &get_deadline() const;
-    [[nodiscard]] bool is_completed() const;
+    [[nodiscard]] constexpr todo_id get_id() const;
+    [[nodiscard]] constexpr std::string_view get_title() const;
+    [[nodiscard]] std::string_view get_description() const;
+    [[nodiscard]] constexpr const time_pt &get_created() const;
+    [[nodiscard]] constexpr const time_pt &get_deadline() const;
+    [[nodiscard]] constexpr bool is_completed() const;
+    [[nodiscard]] bool is_dirty() const;
 
     // Setters
     void set_title(std::string_view title);
@@ -84,29 +137,67 @@ public:
     void set_completed(bool completed);
 
 private:
-    int id;
+    todo_id id;
 
     time_pt created;
     time_pt deadline;
 
-    std::string title;
-    std::string description;
+    text title;
+    text description;
 
     bool completed = false;
+    bool dirty = false; // edited since it was last written out
 
-    todo() = default; // Not accessible except for serialization
-
-    // Serialization
-    template <typename Archive>
-    void serialize(Archive &ar, const unsigned int version) {
-        ar & id;
-        ar & boost::serialization::make_binary_object(&created, sizeof(created));;
-        ar & boost::serialization::make_binary_object(&deadline, sizeof(deadline));
-        ar & title;
-        ar & description;
-        ar & completed;
-    }
+    // Not accessible except for loading snapshots
+    explicit todo(const allocator_type &alloc);
 };
+
+// Inline so that the orderings can see through them
+constexpr text::operator std::string_view() const {
+    return borrowing ? borrowed : std::string_view { owned };
+}
+
+[[nodiscard]] constexpr todo_id todo::get_id() const {
+    return id;
+}
+
+[[nodiscard]] constexpr std::string_view todo::get_title() const {
+    return title;
+}
+
+[[nodiscard]] constexpr const todo::time_pt &todo::get_created() const {
+    return created;
+}
+
+[[nodiscard]] constexpr const todo::time_pt &todo::get_deadline() const {
+    return deadline;
+}
+
+[[nodiscard]] constexpr bool todo::is_completed() const {
+    return completed;
+}
+
+namespace order {
+    constexpr bool by_deadline::operator()(const todo &lhs, const todo &rhs) const {
+        return lhs.get_deadline() < rhs.get_deadline();
+    }
+
+    constexpr bool by_created::operator()(const todo &lhs, const todo &rhs) const {
+        return lhs.get_created() < rhs.get_created();
+    }
+
+    constexpr bool by_completed::operator()(const todo &lhs, const todo &rhs) const {
+        return lhs.is_completed() < rhs.is_completed();
+    }
+
+    constexpr bool by_title::operator()(const todo &lhs, const todo &rhs) const {
+        return lhs.get_title() < rhs.get_title();
+    }
+
+    constexpr bool by_id::operator()(const todo &lhs, const todo &rhs) const {
+        return lhs.get_id() < rhs.get_id();
+    }
+}
 }
 
 #endif
\ No newline at end of file
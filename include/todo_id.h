@@ -0,0 +1,74 @@
+/**
+ *
+ * todo_id.h
+ *
+ * Time-ordered 64-bit todo ids
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _TODO_ID_H_
+#define _TODO_ID_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace p2d {
+// Made without any coordination and sorted by the time they were made.
+// Bits, from the top:
+//   1   zero, so ids fit the int64 fields of the file formats
+//   41  milliseconds since id_generator::epoch
+//   10  node, picked at random once per data directory and kept in its index
+//   12  sequence within the millisecond
+// Ids from one instance never repeat. Across instances they are unique only
+// as long as the nodes differ, which nothing checks: among 38 instances two
+// share a node about half the time, and those two collide whenever both
+// make an id in the same millisecond. A list handed an id it already holds
+// gives that todo a new one (todo_list::add_range()), so a collision costs
+// an id, not a todo. Lists written before these ids have small ones, which
+// cannot collide with any generated id.
+using todo_id = std::uint64_t;
+
+class id_generator {
+public:
+    static constexpr std::uint64_t epoch = 1704067200000; // 2024-01-01 UTC, in ms
+    static constexpr int node_bits = 10;
+    static constexpr int sequence_bits = 12;
+
+    explicit id_generator(std::uint16_t node = 0);
+
+    // Disable copy semantics
+    id_generator(const id_generator &other) = delete;
+    id_generator &operator=(const id_generator &other) = delete;
+
+    // Safe to call from several threads. Every id is greater than the last
+    // one generated or observed, even if the clock steps back: the time
+    // part then runs ahead of the clock until the clock catches up.
+    [[nodiscard]] todo_id next();
+    // Keeps later ids above id, e.g. one loaded from disk or another peer
+    void observe(todo_id id);
+    // No later id is at or below this one
+    [[nodiscard]] todo_id latest() const;
+
+    [[nodiscard]] std::uint16_t node() const;
+    void set_node(std::uint16_t node);
+
+    // Time part of id, in ms since the Unix epoch; 0 for a pre-64-bit id
+    [[nodiscard]] static std::uint64_t millis(todo_id id);
+
+private:
+    static constexpr int time_shift = node_bits + sequence_bits;
+    static constexpr std::uint64_t sequence_mask = (1u << sequence_bits) - 1;
+    static constexpr std::uint64_t node_mask = (1u << node_bits) - 1;
+
+    // Time and sequence of the latest id, without the node bits
+    std::atomic<std::uint64_t> last = 0;
+    std::atomic<std::uint16_t> node_id;
+};
+
+// The generator every todo_list takes new ids from
+[[nodiscard]] id_generator &todo_ids();
+}
+
+#endif
@@ -12,27 +12,90 @@
 #define _TODO_LIST_H_
 
 #include <algorithm>
-#include <functional>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <optional>
+#include <ranges>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
-#include <boost/serialization/access.hpp>
-#include <boost/serialization/vector.hpp>
-
+#include "search_index.h"
+#include "task_pool.h"
 #include "todo.h"
 
 namespace rng = std::ranges;
 
 namespace p2d {
+class mapped_file;
+
+// Orderings a todo_list can be viewed in
+enum class todo_order : std::uint8_t {
+    deadline,
+    created,
+    completed,
+    title,
+};
+inline constexpr std::size_t todo_order_count = 4;
+
+// What each todo_order sorts by. All are stable, so views are total orders.
+using orderings = std::tuple<
+    order::stable<order::by_deadline, order::by_title>,
+    order::stable<order::by_created>,
+    order::stable<order::by_completed, order::by_deadline>,
+    order::stable<order::by_title>>;
+static_assert(std::tuple_size_v<orderings> == todo_order_count);
+
+template <todo_order O>
+using ordering_of = std::tuple_element_t<static_cast<std::size_t>(O), orderings>;
+
+// Conditions on the hot fields of a todo, all of which must hold. Bounds
+// are inclusive; todos without a deadline are due at time_pt::max().
+struct todo_filter {
+    todo::time_pt due_from = todo::time_pt::min();
+    todo::time_pt due_until = todo::time_pt::max();
+    todo::time_pt created_from = todo::time_pt::min();
+    todo::time_pt created_until = todo::time_pt::max();
+    std::optional<bool> completed; // either, if unset
+};
+
+[[nodiscard]] std::string_view order_name(todo_order order);
+// The ordering after order, wrapping around
+[[nodiscard]] todo_order next_order(todo_order order);
+
+// Told about every todo entering or leaving a list, e.g. to keep an index
+// outside the list in sync. An edit is a removal followed by an addition.
+class todo_watcher {
+public:
+    virtual ~todo_watcher() = default;
+
+    virtual void added(const todo &t) = 0;
+    virtual void removed(const todo &t) = 0;
+};
+
+// Todos are stored in no particular order. For every ordering that has been
+// used, the list keeps a view: indexes into the storage sorted by that
+// ordering. Views are updated in place on every change, so switching the
+// order never moves a todo.
+//
+// Positions taken and returned by the member functions are positions in
+// the current order, as shown on screen.
 class todo_list {
-    using compare_by = std::function<bool(const todo &, const todo &)>;
-    friend class boost::serialization::access;
+    friend class snapshot;
 
 public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
     // Constructors
-    todo_list(std::string_view title);
+    // Title, todos and their texts all come from alloc's memory resource
+    todo_list(std::string_view title, const allocator_type &alloc = {});
     todo_list(todo_list &&rhs) noexcept = default;
+    todo_list(todo_list &&rhs, const allocator_type &alloc);
 
     // Disable copy semantics
     todo_list(const todo_list &rhs) = delete;
@@ -41,63 +104,268 @@ public:
     // Operators
     todo_list &operator=(todo_list &&rhs) noexcept = default;
 
+    // The todo at pos in the current order
+    [[nodiscard]] todo &operator[](std::size_t pos);
+    [[nodiscard]] const todo &operator[](std::size_t pos) const;
+
     // Getters
-    [[nodiscard]] std::string &get_title();
-    [[nodiscard]] std::vector<todo> &get_todos();
-    [[nodiscard]] const std::string &get_title() const;
-    [[nodiscard]] const std::vector<todo> &get_todos() const;
+    [[nodiscard]] std::pmr::string &get_title();
+    [[nodiscard]] const std::pmr::string &get_title() const;
+    // Storage order, for callers that do not care about the order
+    [[nodiscard]] const std::pmr::vector<todo> &get_todos() const;
+    [[nodiscard]] allocator_type get_allocator() const;
+
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] bool empty() const;
+    // Bytes of title and description over all todos, kept as they change
+    [[nodiscard]] std::size_t text_bytes() const;
+
+    // All todos in the current order
+    [[nodiscard]] auto view() const {
+        return views[index_of(active)] | std::views::transform([this](std::uint32_t i) -> const todo & {
+            return todos[i];
+        });
+    }
+
+    // All todos in order, whatever the current one is; its view is built
+    // on first use like sort() would
+    [[nodiscard]] auto view(todo_order order) {
+        index_tail();
+        if (!built[index_of(order)]) {
+            build(order);
+        }
+        return views[index_of(order)] | std::views::transform([this](std::uint32_t i) -> const todo & {
+            return todos[i];
+        });
+    }
+
+    // Both are O(1) through the id index
+    [[nodiscard]] std::pmr::vector<todo>::iterator find(todo_id id);
+    [[nodiscard]] std::pmr::vector<todo>::const_iterator find(todo_id id) const;
+    // Position of the todo with id in the current order, or size()
+    [[nodiscard]] std::size_t position(todo_id id) const;
 
-    [[nodiscard]] std::vector<todo>::iterator find(int id);
-    [[nodiscard]] std::vector<todo>::const_iterator find(int id) const;
+    // Scans over the hot columns, which are built on the first scan and
+    // kept up to date from then on. Not to be used while batching.
+    [[nodiscard]] std::size_t count(const todo_filter &filter) const;
+    // The same, in chunks spread over pool
+    [[nodiscard]] std::size_t count(const todo_filter &filter, task_pool &pool) const;
+    // Ids of the matching todos, in the current order
+    [[nodiscard]] std::vector<todo_id> select(const todo_filter &filter) const;
+
+    // Ids of the todos whose title or description contains query, ignoring
+    // ASCII case, in the current order. The trigram index behind it is
+    // built on the first search and kept up to date from then on.
+    [[nodiscard]] std::vector<todo_id> search(std::string_view query) const;
 
     // Member functions
+    // Both return the position the todo landed at. New ids come from
+    // todo_ids(), so they are unique across lists, and across instances
+    // unless two picked the same node (see todo_id.h).
     template <typename... Args>
     int add(Args&& ...args) {
-        todo new_todo { current_id++, std::forward<Args>(args)... };
-        int id = new_todo.id;
-        todos.push_back(std::move(new_todo));
-        sort();
-
-        // return index, find it using lambda
-        return [&] {
-            auto it = rng::find_if(todos, [id](const todo &t) {
-                return t.id == id;
-            });
-            return std::distance(begin(todos), it);
-        }();
+        return insert(todo { todo_ids().next(), std::forward<Args>(args)... });
+    }
+
+    // Inserts a todo keeping its own id, e.g. when replaying the journal
+    int insert(todo &&new_todo);
+
+    // Adds every todo of the range, sorting only the new ones and merging
+    // them into each view. A todo keeps its id unless the list already has
+    // it, e.g. one moved here from another list, or its id is 0.
+    template <rng::input_range R>
+        requires std::same_as<rng::range_value_t<R>, todo>
+    void add_range(R &&range) {
+        if constexpr (rng::sized_range<R>) {
+            todos.reserve(todos.size() + rng::size(range));
+        }
+        for (auto &&t : range) {
+            todo &added = todos.emplace_back(std::move(t));
+            if (added.id == 0 || positions.contains(added.id)) {
+                added.id = todo_ids().next();
+            } else {
+                todo_ids().observe(added.id);
+            }
+            positions[added.id] = todos.size() - 1;
+            store_hot(todos.size() - 1);
+            track(todos.size() - 1);
+        }
+
+        dirty = true;
+        if (!batching) {
+            index_tail();
+        }
+    }
+
+    // Between these, add() and insert() only append to the storage; the
+    // views take in the whole batch at end_batch(). Until then the list is
+    // only good for adding, and the positions returned are storage indexes.
+    void begin_batch();
+    void end_batch();
+
+    bool remove(int pos);
+
+    // Bulk edits, one pass over the storage however many todos match.
+    // pred is called once per todo. The ids affected come back in storage
+    // order, e.g. for a single journal record. Not to be used while batching.
+    template <typename Pred>
+    std::vector<todo_id> remove_if(Pred pred) {
+        return erase_matching(match(pred), nullptr);
+    }
+
+    // Completes, or reopens, the matching todos that are not so already
+    template <typename Pred>
+    std::vector<todo_id> mark_if(Pred pred, bool completed) {
+        return complete_matching(match(pred), completed);
+    }
+
+    // Takes the matching todos out for another list's add_range(). They
+    // are moved, not copied, except for texts borrowed from a snapshot, and
+    // still carry their ids from this list.
+    template <typename Pred>
+    std::pmr::vector<todo> extract_if(Pred pred) {
+        std::pmr::vector<todo> taken { get_allocator() };
+        erase_matching(match(pred), &taken);
+        return taken;
     }
 
-    bool remove(int id);
+    // Edits the todo at pos through fn, keeping every view in order.
+    // Returns its new position.
+    template <typename F>
+    int update(std::size_t pos, F &&fn) {
+        const std::uint32_t index = detach(pos);
+        std::forward<F>(fn)(todos[index]);
+        dirty = true;
+        store_hot(index);
+        track(index);
+        return attach(index);
+    }
+
+    // At most one watcher at a time; nullptr stops watching
+    void watch(todo_watcher *watcher);
 
-    // Comparison options:
-    //   order::by_deadline
-    //   order::by_created
-    //   order::by_completed
-    //   order::by_title
-    void sort(compare_by cmp = order::by_deadline {});
+    // Switches to another ordering; its view is built on first use
+    void sort(todo_order order = todo_order::deadline);
+    [[nodiscard]] todo_order get_order() const;
 
-    bool mark_as_completed(int id);
-    bool mark_as_incomplete(int id);
+    bool mark_as_completed(int pos);
+    bool mark_as_incomplete(int pos);
 
     bool clear();
 
+    // True if the list or any of its todos changed since mark_clean().
+    // O(1): every edit goes through the list, which notes it.
+    [[nodiscard]] bool is_dirty() const;
+    void mark_clean();
+
+    // Changes whenever what the views show may have: a todo added, removed
+    // or edited, or another order. Never repeats, even across lists, so it
+    // can key a cache of rows drawn from the list.
+    [[nodiscard]] std::uint64_t get_revision() const;
+
 private:
-    std::string title;
-    std::vector<todo> todos;
+    using view_type = std::pmr::vector<std::uint32_t>;
+
+    std::pmr::string title;
+    std::pmr::vector<todo> todos;
+
+    std::array<view_type, todo_order_count> views;
+    std::array<bool, todo_order_count> built {};
+    todo_order active = todo_order::deadline;
+
+    // id -> index in todos
+    std::pmr::unordered_map<todo_id, std::uint32_t> positions;
+
+    // The fields scans look at, one array each, parallel to todos. Strings
+    // stay behind in todos, so a scan reads 25 bytes per todo.
+    struct hot_columns {
+        std::pmr::vector<todo_id> id;
+        std::pmr::vector<todo::time_pt::rep> deadline;
+        std::pmr::vector<todo::time_pt::rep> created;
+        std::pmr::vector<std::uint8_t> completed;
+
+        explicit hot_columns(const allocator_type &alloc);
+        hot_columns(hot_columns &&rhs, const allocator_type &alloc);
+
+        void assign(std::size_t index, const todo &t);
+        void push_back(const todo &t);
+        void pop_back();
+        void resize(std::size_t size);
+        void clear();
+    };
+    mutable hot_columns hot;
+    mutable bool hot_built = false;
+
+    mutable search_index text_index;
+    mutable bool text_built = false;
+
+    todo_watcher *watcher = nullptr;
 
     static constexpr std::string_view box_unchecked = "☐";
     static constexpr std::string_view box_checked = "☑";
+    // Smallest chunk of a scan worth handing to another thread
+    static constexpr std::size_t scan_grain = 1 << 16;
+
+    // Snapshot the todo texts borrow from, kept alive as long as this list
+    std::shared_ptr<const mapped_file> backing;
+
+    bool dirty = true; // a list not loaded from disk has yet to be written
+    bool batching = false;
+    std::uint64_t revision = next_revision();
+    std::size_t indexed = 0; // todos before this index are in every view
+    std::size_t text_size = 0; // see text_bytes()
 
-    todo_list() = default; // for serialization
+    [[nodiscard]] static std::uint64_t next_revision();
 
-    template <typename Archive>
-    void serialize(Archive &ar, const unsigned int version) {
-        ar & title;
-        ar & todos;
+    [[nodiscard]] static constexpr std::size_t index_of(todo_order order) {
+        return static_cast<std::size_t>(order);
     }
 
-    int current_id = 0;
+    // Calls fn with the ordering of order as a value of its own type, so
+    // the code under it is compiled once per ordering
+    template <typename F>
+    static decltype(auto) with_ordering(todo_order order, F &&fn);
+
+    // Mirrors todos[index] into the hot columns, if they are built
+    void store_hot(std::uint32_t index);
+    void build_hot() const;
+    void build_text() const;
+    // Adds todos[index] to the search index, if it is built, and to the
+    // text size, and tells the watcher; untrack() undoes all three. Either
+    // starts a new revision.
+    void track(std::uint32_t index);
+    void untrack(std::uint32_t index);
+
+    // One flag per todo in storage, set where pred holds
+    template <typename Pred>
+    [[nodiscard]] std::vector<std::uint8_t> match(Pred &pred) const {
+        std::vector<std::uint8_t> matched(todos.size());
+        for (std::size_t i = 0; i < todos.size(); i++) {
+            matched[i] = pred(std::as_const(todos[i]));
+        }
+        return matched;
+    }
+    // Removes the flagged todos, moving them to taken if given
+    std::vector<todo_id> erase_matching(const std::vector<std::uint8_t> &matched, std::pmr::vector<todo> *taken);
+    std::vector<todo_id> complete_matching(const std::vector<std::uint8_t> &matched, bool completed);
+
+    // Takes the todo at pos out of every view and the search index, and
+    // returns its storage index
+    std::uint32_t detach(std::size_t pos);
+    // Puts it back and returns its position in the current order
+    int attach(std::uint32_t index);
+
+    // Brings todos past indexed into every view
+    void index_tail();
+    void build(todo_order order);
+    // Recomputes the id index and views after the storage was filled
+    void rebuild();
+
+    // Compares storage indexes by the todos they point at
+    template <typename Compare>
+    [[nodiscard]] auto by_index(Compare cmp) const;
+    [[nodiscard]] view_type::iterator locate(todo_order order, std::uint32_t index);
 };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,143 @@
+/**
+ *
+ * todo_store.h
+ *
+ * Sharded on-disk storage of todo lists
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _TODO_STORE_H_
+#define _TODO_STORE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "checkpointer.h"
+#include "deadline_index.h"
+#include "journal.h"
+#include "task_pool.h"
+#include "todo_list.h"
+
+namespace p2d {
+// Summary of one list, enough to render the main screen
+struct list_info {
+    std::string title;
+    std::uint64_t shard;
+    std::uint32_t todo_count = 0;
+    todo::time_pt next_deadline = todo::time_pt::max(); // earliest incomplete
+    // Every id in the list lies in [min_id, max_id] while it is not loaded
+    todo_id min_id = 0;
+    todo_id max_id = std::numeric_limits<todo_id>::max();
+};
+
+// Lists live in one shard file each, next to a small index of list_info.
+// Only the index is read on startup; a shard is loaded the first time its
+// list is opened and evicted again once loaded shards exceed the budget.
+// Writing is left to checkpoints: the store only encodes what changed.
+//
+// Each loaded shard allocates from its own monotonic arena, so eviction
+// returns all of its memory at once instead of todo by todo.
+//
+// The deadlines of every list, loaded or not, are kept in one index that is
+// saved with the list index and checked against each shard as it loads.
+class todo_store {
+public:
+    todo_store() = default;
+
+    // Disable copy semantics
+    todo_store(const todo_store &other) = delete;
+    todo_store &operator=(const todo_store &other) = delete;
+
+    // Reads the index only. Returns the journal lsn it covers.
+    std::uint64_t open(const std::filesystem::path &dir);
+    // Fills the store, once open, from a single todo file of the builds
+    // before shards, in any of their formats. Every shard and then the
+    // index are on disk before file is removed; if the index was already
+    // there, an earlier import got that far and file only goes away.
+    // Returns the journal lsn the store covers.
+    std::uint64_t import(const std::filesystem::path &file, task_pool &pool);
+
+    // Applies a replayed journal record, loading its shard if needed
+    void apply(const journal::record &r);
+
+    [[nodiscard]] const std::vector<list_info> &lists() const;
+    [[nodiscard]] std::size_t size() const;
+    // Lists are identified by their shard id
+    [[nodiscard]] const deadline_index &deadlines() const;
+    // Whether any list has a todo with id. A shard not loaded is loaded
+    // only if its id range covers id.
+    [[nodiscard]] bool contains(todo_id id);
+
+    // Loads the shard on first use
+    [[nodiscard]] todo_list &get(std::size_t index);
+
+    // Both return the shard id of the list
+    std::uint64_t create(std::string_view title);
+    std::uint64_t remove(std::size_t index);
+
+    // Recomputes the index entry of a loaded list after it was edited
+    void refresh(std::size_t index);
+    void refresh();
+
+    // Evicts least recently used shards, except keep, until under budget.
+    // Only shards whose contents are on disk, i.e. clean and not waiting on
+    // a checkpoint newer than settled, can be evicted.
+    void trim(std::size_t keep, std::uint64_t settled);
+    [[nodiscard]] bool over_budget() const;
+    void set_budget(std::size_t bytes);
+
+    // Adds the index and every edited shard (or every loaded one), stamped
+    // with lsn, to job, encoding the shards on pool. Shards are marked clean
+    // right away.
+    void capture(std::uint64_t lsn, checkpoint_job &job, task_pool &pool, bool everything = false);
+
+private:
+    struct shard {
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> arena; // outlives list
+        todo_list list;
+        std::uint64_t lsn = 0; // last journal record the shard file covers
+        std::uint64_t last_used = 0;
+        std::uint64_t in_flight = 0; // checkpoint job carrying its latest contents
+        std::size_t footprint = 0;
+        std::unique_ptr<deadline_watcher> watcher; // keeps due in sync with list
+    };
+
+    std::filesystem::path dir;
+    std::vector<list_info> index;
+    std::unordered_map<std::uint64_t, shard> loaded;
+    std::vector<std::uint64_t> removed; // shard files to delete at the next checkpoint
+    deadline_index due;
+
+    std::uint64_t index_lsn = 0;
+    std::uint64_t next_shard = 0;
+    std::uint64_t clock = 0;
+
+    std::size_t budget = 64 << 20;
+    std::size_t resident = 0;
+
+    static constexpr std::string_view index_file = "index.bin";
+
+    shard &load(std::uint64_t id);
+    [[nodiscard]] static shard make_shard(std::string_view title, std::size_t todo_count);
+    // Starts keeping due in sync with a freshly loaded or created shard
+    void watch(std::uint64_t id, shard &s);
+    void evict(std::uint64_t id);
+    [[nodiscard]] std::string encode_index(std::uint64_t lsn) const;
+
+    [[nodiscard]] std::vector<list_info>::iterator find(std::uint64_t id);
+    [[nodiscard]] std::filesystem::path shard_path(std::uint64_t id) const;
+
+    static std::size_t footprint(const todo_list &list);
+};
+}
+
+#endif
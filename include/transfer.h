@@ -0,0 +1,97 @@
+/**
+ *
+ * transfer.h
+ *
+ * Streaming import and export of todos as JSON Lines or CSV
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#ifndef _TRANSFER_H_
+#define _TRANSFER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "todo.h"
+
+namespace p2d {
+enum class transfer_format {
+    jsonl, // {"list":..,"id":..,"title":..,"description":..,"created":..,"deadline":..,"completed":..}
+    csv,   // header row, then list,id,title,description,created,deadline,completed
+};
+
+// "jsonl"/"json"/"csv", or a file name ending in one of them
+[[nodiscard]] std::optional<transfer_format> transfer_format_of(std::string_view name);
+
+// One todo as it appears in a transfer file. Times are UTC in
+// "YYYY-MM-DDTHH:MM:SSZ"; a todo without a deadline has none written.
+struct todo_row {
+    std::string list;
+    todo_id id = 0; // 0 if the row has none
+    std::string title;
+    std::string description;
+    todo::time_pt created;
+    todo::time_pt deadline = todo::time_pt::max();
+    bool completed = false;
+};
+
+struct transfer_stats {
+    std::uint64_t records = 0;
+    std::chrono::microseconds elapsed { 0 };
+
+    [[nodiscard]] double per_second() const;
+};
+
+// Both sides hold a single record at a time, so memory use does not grow
+// with the size of the file.
+class todo_writer {
+public:
+    todo_writer(std::ostream &out, transfer_format format);
+
+    void write(std::string_view list, const todo &t);
+
+    [[nodiscard]] std::uint64_t count() const;
+
+private:
+    std::ostream &out;
+    transfer_format file_format;
+    std::string line;
+    std::uint64_t written = 0;
+};
+
+class todo_reader {
+public:
+    todo_reader(std::istream &in, transfer_format format);
+
+    // Fills row with the next record, reusing its buffers. Returns false at
+    // the end of the input; throws runtime_error on a malformed record.
+    bool next(todo_row &row);
+
+    [[nodiscard]] std::uint64_t line() const;
+
+private:
+    std::istream &in;
+    transfer_format file_format;
+    std::string buffer;
+    std::uint64_t line_number = 0;
+
+    // Fields of the current CSV record, kept across records for reuse
+    std::vector<std::string> fields;
+    std::size_t field_count = 0;
+    // CSV column of each todo_row field, from the header
+    std::vector<int> columns;
+
+    bool next_json(todo_row &row);
+    bool next_csv(todo_row &row);
+    bool read_csv_record();
+};
+}
+
+#endif
@@ -18,11 +18,16 @@
 #include <ncurses.h>
 #endif
 
+#include <cstdint>
 #include <cstdlib>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "agenda.h"
+#include "authenticator.h"
 #include "todo_list.h"
+#include "todo_store.h"
 #include "user_list.h"
 
 namespace p2d {
@@ -33,21 +38,31 @@ public:
 
     int list_selected_index() const;
     int memo_selected_index() const;
+    int agenda_selected_index() const;
 
-    virtual std::pair<std::string, int> show_all_lists(const std::vector<todo_list>& todoLists);
+    // Ids of the todos marked for a bulk action, and the list a move goes to
+    const std::vector<todo_id>& marked() const;
+    const std::string& move_target() const;
+    void clear_marks();
+
+    virtual std::pair<std::string, int> show_all_lists(const std::vector<list_info>& todoLists);
     virtual std::pair<std::string, int> list_memos(const todo_list& todoList);
+    virtual std::pair<std::string, int> show_agenda(agenda& rows, const std::vector<list_info>& todoLists);
 
-    virtual void create_list(std::vector<todo_list>& todoLists);
-    virtual void create_memo(todo_list& todoList);
+    virtual std::string create_list();
+    virtual int create_memo(todo_list& todoList);
     virtual void interact_memo(todo& memo);
 
-    virtual void login(std::unique_ptr<user>& current_user, user_list& all_users);
+    virtual void login(std::unique_ptr<user>& current_user, user_list& all_users, const authenticator& auth);
 
     virtual void clear();
 
 protected:
     int list_selected = 0; // current selected list
     int memo_selected = 0; // current selected memo
+    int agenda_selected = 0; // current selected row of the agenda
+    std::vector<todo_id> marked_ids; // marked todos of the current list
+    std::string move_title; // list the marked todos move to
 };
 
 #ifndef DONT_USE_NCURSES
@@ -56,14 +71,15 @@ public:
     ui_manager_ncurses();
     ~ui_manager_ncurses() override;
 
-    virtual std::pair<std::string, int> show_all_lists(const std::vector<todo_list>& todoLists) override;
+    virtual std::pair<std::string, int> show_all_lists(const std::vector<list_info>& todoLists) override;
     virtual std::pair<std::string, int> list_memos(const todo_list& todoList) override;
+    virtual std::pair<std::string, int> show_agenda(agenda& rows, const std::vector<list_info>& todoLists) override;
 
-    virtual void create_list(std::vector<todo_list>& todoLists) override;
-    virtual void create_memo(todo_list& todoList) override;
+    virtual std::string create_list() override;
+    virtual int create_memo(todo_list& todoList) override;
     virtual void interact_memo(todo& memo) override;
 
-    virtual void login(std::unique_ptr<user>& current_user, user_list& all_users) override;
+    virtual void login(std::unique_ptr<user>& current_user, user_list& all_users, const authenticator& auth) override;
 
     void clear() override;
 
@@ -93,9 +109,84 @@ private:
         curs_set(0);
     }
 
+    // Selects the next todo matching search_query after the selection,
+    // wrapping around; shows the outcome in the bottom window
+    void next_match(const todo_list& todoList);
+
+    // What a row of the list window shows: the position of the item in
+    // it, or -1 if blank, and how it is highlighted. Items do not change
+    // while a view is up, so equal keys mean equal rows.
+    struct row_key {
+        int pos = -1;
+        bool selected = false;
+        bool marked = false;
+
+        bool operator==(const row_key& other) const = default;
+    };
+
+    // Moves the selection of a view of count items for a key: arrows, Page
+    // Up/Down, Home or End. False if ch is none of them.
+    bool move_selection(int ch, int count, int& selected, int& offset);
+    // Asks for a position in the bottom window and selects it
+    void jump(int count, int& selected, int& offset);
+    // Clamps selected to the items and scrolls as little as it takes to
+    // show it
+    void keep_visible(int count, int& selected, int& offset);
+
+    // The row of the todo at pos, formatted once per revision of the list
+    // and unmarked; the mark is set on the copy drawn
+    const std::string& memo_row(const todo_list& todoList, int pos);
+
+    // Blanks the windows for a new view. Unlike wclear(), this does not
+    // make the next refresh repaint the whole terminal; ncurses only sends
+    // the cells that differ from what is on it.
+    void begin_view();
+
+    // Shows count items from offset on, one per row of the list window.
+    // Only rows whose key changed since the last frame are formatted with
+    // text(pos) and written, e.g. the old and the new selected row after
+    // an arrow key.
+    template <typename Key, typename Text>
+    void draw_rows(int offset, int count, Key&& key, Text&& text) {
+        const int rows = getmaxy(list) - 1;
+        drawn.resize(rows);
+        for (int y = 0; y < rows; y++) {
+            const row_key want = y < count ? key(offset + y) : row_key {};
+            if (want == drawn[y]) {
+                continue;
+            }
+            drawn[y] = want;
+
+            if (want.pos < 0) {
+                wmove(list, y + 1, 0);
+                wclrtoeol(list);
+                continue;
+            }
+            if (want.selected) {
+                wattron(list, COLOR_PAIR(2));
+            }
+            const std::string row = text(want.pos);
+            mvwprintw(list, y + 1, 0, "%-*s", getmaxx(list), row.data()); // 나머지 공간을 공백으로 채움
+            if (want.selected) {
+                wattroff(list, COLOR_PAIR(2));
+            }
+        }
+        wrefresh(list);
+    }
+
 private:
     int list_offset = 0; // current offset of the list
     int memo_offset = 0; // current offset of the memo
+    int agenda_offset = 0; // current offset of the agenda
+    std::vector<row_key> drawn; // rows of the list window as last drawn
+
+    // Rows formatted by memo_row(), by position, all of one revision.
+    // Emptied when full, so that paging through a huge list keeps only
+    // a few screens of them.
+    std::unordered_map<int, std::string> memo_rows;
+    std::uint64_t memo_rows_revision = 0;
+    static constexpr std::size_t memo_rows_max = 4096;
+    std::string search_query; // last query typed after '/'
 };
 #endif // DONT_USE_NCURSES
 }
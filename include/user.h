@@ -11,19 +11,35 @@
 #ifndef _USER_H_
 #define _USER_H_
 
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <type_traits>
 
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/array.hpp>
+#include <boost/serialization/version.hpp>
 
 namespace p2d {
 // Password class
+// Kept as a PBKDF2-HMAC-SHA256 key under a random salt. Checking a guess
+// derives its key at the stored cost, so raising the cost slows down
+// every check, including an attacker's.
 class password {
+    friend class boost::serialization::access;
+
 public:
-    password() = default;
-    password(std::string_view pw);
+    static constexpr std::size_t salt_size = 16;
+    static constexpr std::size_t key_size = 32;
+    // OWASP's advice for PBKDF2-HMAC-SHA256 as of 2023
+    static constexpr std::uint32_t default_iterations = 600000;
+
+    password() = default; // matches nothing
+    password(std::string_view pw, std::uint32_t iterations = default_iterations);
     password(password &&other) noexcept = default;
 
     // Delete copy semantics
@@ -35,9 +51,27 @@ public:
     bool operator==(const password &other) const = default;
     bool operator==(std::string_view other) const;
 
+    // Compares the raw keys in constant time
+    [[nodiscard]] bool matches(std::string_view attempt) const;
+    [[nodiscard]] std::uint32_t get_iterations() const;
+    [[nodiscard]] bool empty() const;
+
 private:
-    std::string create_hash(std::string_view pw);
-    std::string hash;
+    using salt_type = std::array<std::uint8_t, salt_size>;
+    using key_type = std::array<std::uint8_t, key_size>;
+
+    salt_type salt {};
+    key_type key {};
+    std::uint32_t iterations = 0;
+
+    static key_type derive(std::string_view pw, const salt_type &salt, std::uint32_t iterations);
+
+    template <typename Archive>
+    void serialize(Archive &ar, const unsigned int version) {
+        ar & salt;
+        ar & key;
+        ar & iterations;
+    }
 };
 
 // Stream operator
@@ -57,15 +91,21 @@ public:
     user(user &&other) noexcept = default;
 
     // Getters
-    std::string get_name() const;
-    std::string get_email() const;
-    std::string get_id() const;
+    [[nodiscard]] std::string_view get_name() const;
+    [[nodiscard]] std::string_view get_email() const;
+    [[nodiscard]] std::string_view get_id() const;
+    [[nodiscard]] const password &get_password() const;
+
+    void set_password(password &&new_pw);
 
     // Operators
     user &operator=(const user &other);
     user &operator=(user &&other) noexcept = default;
     bool operator==(const user &other) const;
     std::strong_ordering operator<=>(const user &other) const;
+    // Against a bare id, so that sets of users can be searched by id
+    bool operator==(std::string_view id) const;
+    std::strong_ordering operator<=>(std::string_view id) const;
 
 private:
     std::string name;
@@ -74,11 +114,21 @@ private:
     password pw;
 
     // Serialization
+    // Version 0 only had the name, version 1 no password
     template <typename Archive>
     void serialize(Archive &ar, const unsigned int version) {
         ar & name;
+        if (version >= 1) {
+            ar & email;
+            ar & id;
+        }
+        if (version >= 2) {
+            ar & pw;
+        }
     }
 };
 }
 
+BOOST_CLASS_VERSION(p2d::user, 2)
+
 #endif
\ No newline at end of file
@@ -11,8 +11,13 @@
 #ifndef _USER_LIST_H_
 #define _USER_LIST_H_
 
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <map>
 #include <set>
 #include <string_view>
+#include <vector>
 
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/set.hpp>
@@ -20,33 +25,66 @@
 #include "user.h"
 
 namespace p2d {
+// Users ordered by id, looked up by id without building a string, and by
+// email or name prefix through secondary indexes. Every lookup is
+// O(log n), plus the number of users returned.
 class user_list {
     friend class boost::serialization::access;
 
 public:
+    using user_set = std::set<user, std::less<>>;
+
     user_list() = default;
 
     // Remove copy semantics
     user_list(const user_list &other) = delete;
     user_list &operator=(const user_list &other) = delete;
 
+    // The copy drops the password; move the user in to keep it
     bool add(const user &u);
+    bool add(user &&u);
+    // False if there is no user with id
+    bool set_password(std::string_view id, password &&pw);
 
     [[nodiscard]] const user &operator[](std::string_view id) const;
-    [[nodiscard]] std::set<user>::const_iterator find(std::string_view id) const;
+    [[nodiscard]] user_set::const_iterator find(std::string_view id) const;
+
+    // Users with exactly this email, in id order
+    [[nodiscard]] std::vector<const user *> find_by_email(std::string_view email) const;
+    // Users whose name starts with prefix, in name order, at most limit
+    [[nodiscard]] std::vector<const user *> find_by_name(std::string_view prefix,
+        std::size_t limit = std::numeric_limits<std::size_t>::max()) const;
 
     bool remove(std::string_view id);
     [[nodiscard]] bool contains(std::string_view id) const;
-    [[nodiscard]] const std::set<user> &get_users() const;
+    [[nodiscard]] const user_set &get_users() const;
+    [[nodiscard]] std::size_t size() const;
+
+    // True if users were added or removed since mark_clean()
+    [[nodiscard]] bool is_dirty() const;
+    void mark_clean();
 
 private:
-    std::set<user> users;
+    user_set users;
+    // Keys view the strings of the users they point at; set nodes never
+    // move, so both stay valid until the user is removed
+    using secondary = std::multimap<std::string_view, const user *, std::less<>>;
+    secondary by_email;
+    secondary by_name;
+    bool dirty = false;
+
+    void index(const user &u);
+    void unindex(const user &u);
+    void reindex();
 
     template <typename Archive>
     void serialize(Archive &ar, const unsigned int version) {
         ar & users;
+        if constexpr (Archive::is_loading::value) {
+            reindex();
+        }
     }
 };
 }
 
-#endif
\ No newline at end of file
+#endif
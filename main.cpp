@@ -8,6 +8,10 @@
  *
  */
 
+#include <iostream>
+#include <stdexcept>
+
+#include "include/cli.h"
 #include "include/session.h"
 #include "include/ui_manager.h"
 
@@ -27,10 +31,22 @@ using namespace p2d;
 using namespace std;
 
 int main(int argc, char *argv[]) {
-    ui_manager_ncurses ui;
-    session sess { ui };
+    try {
+        // Any argument runs a headless command instead of the UI
+        if (argc > 1) {
+            session sess;
+            return cli { sess }.run(argc, argv);
+        }
+
+        ui_manager_ncurses ui;
+        session sess { ui };
 
-    sess.run();
+        sess.run();
+    } catch (const runtime_error &e) {
+        // Reported once the UI has given the terminal back
+        cerr << e.what() << '\n';
+        return 1;
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+/**
+ *
+ * agenda.cpp
+ *
+ * Todos of every list in one deadline order
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include "../include/agenda.h"
+
+using namespace std;
+
+namespace p2d {
+agenda::agenda(todo_store &store, uint64_t settled)
+    : store { store }
+    , settled { settled }
+    , total { store.deadlines().size() } {
+    for (size_t i = 0; i < store.size(); i++) {
+        lists[store.lists()[i].shard] = i;
+    }
+}
+
+[[nodiscard]] const agenda_row &agenda::operator[](size_t pos) {
+    // Loading a list can change its entries in the index, so the merge
+    // goes on from the last entry by value, not through an iterator
+    while (rows.size() <= pos) {
+        const deadline_index &due = store.deadlines();
+        const auto next = last ? due.after(*last) : due.next_due();
+
+        agenda_row &row = rows.emplace_back();
+        if (!next)
+            continue; // the index lost entries to a load since
+        last = next;
+
+        auto list = lists.find(next->list);
+        if (list == end(lists))
+            continue;
+
+        row.list = list->second;
+        row.id = next->id;
+        row.deadline = next->deadline;
+        const todo_list &todos = store.get(row.list);
+        if (auto it = todos.find(row.id); it != end(todos.get_todos())
+            && !it->is_completed() && it->get_deadline() == row.deadline) {
+            row.title = it->get_title();
+            row.found = true;
+        }
+        store.trim(row.list, settled);
+    }
+    return rows[pos];
+}
+
+[[nodiscard]] size_t agenda::size() const {
+    return total;
+}
+
+[[nodiscard]] bool agenda::empty() const {
+    return total == 0;
+}
+}
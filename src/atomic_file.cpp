@@ -0,0 +1,128 @@
+/**
+ *
+ * atomic_file.cpp
+ *
+ * Crash-safe replacement of a file's contents
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/atomic_file.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace p2d {
+namespace {
+    void throw_errno(const char *what) {
+        throw system_error { errno, generic_category(), what };
+    }
+}
+
+atomic_file::atomic_file(const fs::path &path)
+    : path { path }
+    , temp { path }
+    , buffer(buffer_size) {
+    temp += ".tmp";
+    fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        throw_errno("atomic_file: open");
+
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+atomic_file::~atomic_file() {
+    if (fd >= 0) { // not committed
+        close(fd);
+        unlink(temp.c_str());
+    }
+}
+
+void atomic_file::write(const void *data, size_t size) {
+    xsputn(static_cast<const char *>(data), size);
+}
+
+void atomic_file::write(string_view str) {
+    xsputn(str.data(), str.size());
+}
+
+void atomic_file::commit() {
+    flush();
+    if (fsync(fd) < 0)
+        throw_errno("atomic_file: fsync");
+    if (close(fd) < 0) {
+        fd = -1;
+        throw_errno("atomic_file: close");
+    }
+    fd = -1;
+
+    fs::rename(temp, path);
+
+    // Make the rename itself durable
+    if (int dir = open(path.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+}
+
+[[nodiscard]] uint64_t atomic_file::bytes_written() const {
+    return written + (pptr() - pbase());
+}
+
+atomic_file::int_type atomic_file::overflow(int_type ch) {
+    flush();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+streamsize atomic_file::xsputn(const char *data, streamsize size) {
+    // Large writes skip the buffer instead of going through it in pieces
+    if (static_cast<size_t>(size) >= buffer.size()) {
+        flush();
+        write_fd(data, size);
+        return size;
+    }
+
+    if (epptr() - pptr() < size) {
+        flush();
+    }
+    memcpy(pptr(), data, size);
+    pbump(size);
+    return size;
+}
+
+int atomic_file::sync() {
+    flush();
+    return 0;
+}
+
+void atomic_file::flush() {
+    write_fd(pbase(), pptr() - pbase());
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+void atomic_file::write_fd(const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("atomic_file: write");
+        }
+        data += n;
+        size -= n;
+        written += n;
+    }
+}
+}
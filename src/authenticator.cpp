@@ -0,0 +1,57 @@
+/**
+ *
+ * authenticator.cpp
+ *
+ * Checks passwords of the users in a user_list
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include "../include/authenticator.h"
+
+using namespace std;
+
+namespace p2d {
+authenticator::authenticator(const user_list &users, task_pool &pool, uint32_t iterations)
+    : users { users }
+    , pool { pool }
+    , iterations { iterations } { }
+
+[[nodiscard]] bool authenticator::verify(string_view id, string_view attempt) const {
+    const auto it = users.find(id);
+    if (it != users.get_users().end() && !it->get_password().empty())
+        return it->get_password().matches(attempt);
+
+    // Making the dummy is the one derivation of the first such check
+    bool made = false;
+    call_once(dummy_made, [&] {
+        dummy = hash(attempt);
+        made = true;
+    });
+    if (!made) {
+        (void)dummy.matches(attempt);
+    }
+    return false;
+}
+
+[[nodiscard]] vector<uint8_t> authenticator::verify(span<const login_attempt> attempts) const {
+    vector<uint8_t> results(attempts.size());
+    pool.for_each(attempts.size(), [&](size_t i) {
+        results[i] = verify(attempts[i].id, attempts[i].password);
+    });
+    return results;
+}
+
+[[nodiscard]] password authenticator::hash(string_view pw) const {
+    return password { pw, iterations };
+}
+
+[[nodiscard]] bool authenticator::needs_rehash(const user &u) const {
+    return u.get_password().get_iterations() != iterations;
+}
+
+[[nodiscard]] uint32_t authenticator::get_iterations() const {
+    return iterations;
+}
+}
@@ -0,0 +1,127 @@
+/**
+ *
+ * checkpointer.cpp
+ *
+ * Background writer for snapshots and journal compaction
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <exception>
+
+#include "../include/atomic_file.h"
+#include "../include/checkpointer.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace p2d {
+checkpointer::checkpointer()
+    : worker { &checkpointer::loop, this } { }
+
+checkpointer::~checkpointer() {
+    stop();
+}
+
+void checkpointer::submit(checkpoint_job &&job) {
+    {
+        lock_guard lock { mtx };
+        if (has_failed || stopping)
+            return;
+        queue.push_back(std::move(job));
+    }
+    cv.notify_one();
+}
+
+void checkpointer::stop() {
+    {
+        lock_guard lock { mtx };
+        stopping = true;
+    }
+    cv.notify_one();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+[[nodiscard]] bool checkpointer::busy() const {
+    lock_guard lock { mtx };
+    return running || !queue.empty();
+}
+
+[[nodiscard]] bool checkpointer::failed() const {
+    lock_guard lock { mtx };
+    return has_failed;
+}
+
+[[nodiscard]] uint64_t checkpointer::settled() const {
+    lock_guard lock { mtx };
+    return last_settled;
+}
+
+[[nodiscard]] checkpoint_metrics checkpointer::metrics() const {
+    lock_guard lock { mtx };
+    return stats;
+}
+
+uint64_t checkpointer::run(const checkpoint_job &job) {
+    uint64_t bytes = 0;
+    for (const auto &[path, data] : job.files) {
+        atomic_file fout { path };
+        fout.write(data);
+        fout.commit();
+        bytes += data.size();
+    }
+
+    for (const auto &path : job.obsolete) {
+        error_code ec; // already gone is fine
+        fs::remove(path, ec);
+    }
+
+    if (job.then) {
+        job.then();
+    }
+    return bytes;
+}
+
+void checkpointer::loop() {
+    unique_lock lock { mtx };
+    while (true) {
+        cv.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return; // stopping and drained
+
+        checkpoint_job job = std::move(queue.front());
+        queue.pop_front();
+        running = true;
+        lock.unlock();
+
+        auto start = chrono::steady_clock::now();
+        uint64_t bytes = 0;
+        bool ok = true;
+        try {
+            bytes = run(job);
+        } catch (const exception &) {
+            ok = false;
+        }
+        auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+
+        lock.lock();
+        running = false;
+        if (ok) {
+            last_settled = job.id;
+            stats.completed++;
+            stats.last_duration = elapsed;
+            stats.total_duration += elapsed;
+            stats.last_bytes = bytes;
+            stats.total_bytes += bytes;
+        } else {
+            has_failed = true;
+            stats.failed++;
+            queue.clear();
+        }
+    }
+}
+}
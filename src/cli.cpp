@@ -0,0 +1,525 @@
+/**
+ *
+ * cli.cpp
+ *
+ * Headless command line interface for p2d
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+#include <ctime>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+
+#include "../include/cli.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+namespace p2d {
+namespace {
+    // Same format and local time zone as the deadline prompt of the UI
+    constexpr const char *time_format = "%Y-%m-%d %H:%M:%S";
+
+    todo::time_pt parse_time(const string &str) {
+        tm tm = {};
+        istringstream ss { str };
+        ss >> get_time(&tm, time_format);
+        if (ss.fail()) {
+            // A date alone means the start of that day
+            tm = {};
+            ss.clear();
+            ss.str(str);
+            ss >> get_time(&tm, "%Y-%m-%d");
+            if (ss.fail())
+                throw runtime_error { format("invalid time \"{}\", expected YYYY-MM-DD [HH:MM:SS]", str) };
+        }
+        tm.tm_isdst = -1;
+        return chrono::system_clock::from_time_t(mktime(&tm));
+    }
+
+    string format_time(const todo::time_pt &t) {
+        if (t == todo::time_pt::max())
+            return "-";
+
+        time_t time = chrono::system_clock::to_time_t(t);
+        tm tm;
+        localtime_r(&time, &tm);
+        ostringstream ss;
+        ss << put_time(&tm, time_format);
+        return ss.str();
+    }
+
+    // One todo as ls and find print it
+    string todo_line(const todo &t) {
+        return format("{}\t[{}]\t{}\t{}\n",
+            t.get_id(), t.is_completed() ? "x" : " ", format_time(t.get_deadline()), t.get_title());
+    }
+
+    po::variables_map parse(const vector<string> &args,
+        const po::options_description &opts,
+        const po::positional_options_description &pos) {
+        po::variables_map vm;
+        po::store(po::command_line_parser(args).options(opts).positional(pos).run(), vm);
+        po::notify(vm);
+        return vm;
+    }
+
+    // -f wins, then the file extension, then JSON Lines
+    transfer_format pick_format(const po::variables_map &vm, const string &file) {
+        if (vm.count("format")) {
+            if (auto chosen = transfer_format_of(vm["format"].as<string>()))
+                return *chosen;
+            throw po::error { format("unknown format \"{}\"", vm["format"].as<string>()) };
+        }
+        return transfer_format_of(file).value_or(transfer_format::jsonl);
+    }
+
+    void report(ostream &err, string_view what, const transfer_stats &stats) {
+        err << std::format("{} {} todos in {:.3f} s ({:.0f} todos/s)\n",
+            what, stats.records, stats.elapsed.count() / 1e6, stats.per_second());
+    }
+}
+
+cli::cli(session &sess, ostream &out, ostream &err)
+    : sess { sess }
+    , out { out }
+    , err { err } { }
+
+int cli::run(int argc, char *argv[]) {
+    args command(argv + 1, argv + argc);
+    const int status = !command.empty() && command[0] == "batch" ? run_batch(cin) : dispatch(command);
+
+    try {
+        sess.close();
+    } catch (const exception &e) {
+        err << format("p2d: {}\n", e.what());
+        return 1;
+    }
+    return status;
+}
+
+int cli::run_batch(istream &in) {
+    int status = 0;
+    string line;
+    for (size_t number = 1; getline(in, line); number++) {
+        auto first = line.find_first_not_of(" \t");
+        if (first == string::npos || line[first] == '#')
+            continue; // blank line or comment
+
+        args command = po::split_unix(line);
+        if (command[0] == "batch") {
+            err << format("p2d: line {}: batch cannot be nested\n", number);
+            status = max(status, 2);
+            continue;
+        }
+        if (int ret = dispatch(command); ret != 0) {
+            err << format("p2d: line {} failed\n", number);
+            status = max(status, ret);
+        }
+    }
+    return status;
+}
+
+int cli::dispatch(const args &command) {
+    if (command.empty()) {
+        print_usage();
+        return 2;
+    }
+
+    const string &name = command[0];
+    const args rest(begin(command) + 1, end(command));
+    if (!sess.logged_in() && name != "help" && name != "-h" && name != "--help") {
+        err << "p2d: not logged in; run p2d without arguments to log in\n";
+        return 1;
+    }
+
+    try {
+        if (name == "add")
+            add(rest);
+        else if (name == "done")
+            done(rest);
+        else if (name == "ls")
+            ls(rest);
+        else if (name == "rm")
+            rm(rest);
+        else if (name == "mv")
+            mv(rest);
+        else if (name == "find")
+            find(rest);
+        else if (name == "due")
+            due(rest);
+        else if (name == "count")
+            count(rest);
+        else if (name == "export")
+            export_todos(rest);
+        else if (name == "import")
+            import_todos(rest);
+        else if (name == "help" || name == "-h" || name == "--help")
+            print_usage();
+        else {
+            err << format("p2d: unknown command \"{}\"\n", name);
+            print_usage();
+            return 2;
+        }
+    } catch (const po::error &e) {
+        err << format("p2d {}: {}\n", name, e.what());
+        return 2;
+    } catch (const exception &e) {
+        err << format("p2d {}: {}\n", name, e.what());
+        return 1;
+    }
+    return 0;
+}
+
+void cli::add(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("list", po::value<string>()->required())
+        ("title", po::value<string>()->required())
+        ("description,d", po::value<string>()->default_value(""))
+        ("due", po::value<string>());
+    po::positional_options_description pos;
+    pos.add("list", 1).add("title", 1);
+    auto vm = parse(command, opts, pos);
+
+    const string &title = vm["list"].as<string>();
+    auto deadline = vm.count("due") ? parse_time(vm["due"].as<string>()) : todo::time_pt::max();
+
+    size_t list = sess.find_list(title).value_or(sess.lists().size());
+    if (list == sess.lists().size()) {
+        list = sess.create_list(title);
+    }
+    out << sess.add_todo(list, vm["title"].as<string>(), vm["description"].as<string>(), deadline) << '\n';
+}
+
+void cli::done(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("list", po::value<string>()->required())
+        ("id", po::value<vector<todo_id>>()->required());
+    po::positional_options_description pos;
+    pos.add("list", 1).add("id", -1);
+    auto vm = parse(command, opts, pos);
+
+    size_t list = require_list(vm["list"].as<string>());
+    const auto &ids = vm["id"].as<vector<todo_id>>();
+    require_todos(list, ids);
+    sess.complete_todos(list, ids);
+}
+
+void cli::ls(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("list", po::value<string>())
+        ("due-before", po::value<string>());
+    po::positional_options_description pos;
+    pos.add("list", 1);
+    auto vm = parse(command, opts, pos);
+
+    const bool due_filter = vm.count("due-before") > 0;
+    const auto before = due_filter ? parse_time(vm["due-before"].as<string>()) : todo::time_pt::max();
+
+    auto print_todo = [&](size_t index, bool with_list, const todo &t) {
+        if (with_list)
+            out << sess.lists()[index].title << '\t';
+        out << todo_line(t);
+    };
+    auto print_todos = [&](size_t index, bool with_list) {
+        const todo_list &list = sess.open_list(index);
+        if (!due_filter) {
+            for (const todo &t : list.view()) {
+                print_todo(index, with_list, t);
+            }
+            return;
+        }
+
+        todo_filter open_and_due { .due_until = before - todo::time_pt::duration { 1 }, .completed = false };
+        for (todo_id id : list.select(open_and_due)) {
+            print_todo(index, with_list, *list.find(id));
+        }
+    };
+
+    if (vm.count("list")) {
+        print_todos(require_list(vm["list"].as<string>()), false);
+        return;
+    }
+
+    const auto &lists = sess.lists();
+    for (size_t i = 0; i < lists.size(); i++) {
+        if (!due_filter) {
+            out << format("{}\t{}\n", lists[i].title, lists[i].todo_count);
+        }
+        // The index knows each list's earliest open deadline, so only
+        // lists that can match are loaded
+        else if (lists[i].next_deadline < before) {
+            print_todos(i, true);
+        }
+    }
+}
+
+void cli::rm(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("list", po::value<string>()->required())
+        ("id", po::value<vector<todo_id>>())
+        ("done", po::bool_switch())
+        ("all", po::bool_switch());
+    po::positional_options_description pos;
+    pos.add("list", 1).add("id", -1);
+    auto vm = parse(command, opts, pos);
+
+    // The whole list goes only when asked for by name, so that a script
+    // whose id list came out empty removes nothing
+    const bool all = vm["all"].as<bool>(), done = vm["done"].as<bool>();
+    if (all && (done || vm.count("id")))
+        throw po::error { "--all removes the whole list; give it alone" };
+    if (!all && !done && !vm.count("id"))
+        throw po::error { "nothing to remove; give ids, --done, or --all for the whole list" };
+
+    size_t list = require_list(vm["list"].as<string>());
+    if (all) {
+        sess.remove_list(list);
+        return;
+    }
+    // Checked before --done can take any of them, so that a missing id
+    // removes nothing at all
+    const auto ids = vm.count("id") ? vm["id"].as<vector<todo_id>>() : vector<todo_id> {};
+    require_todos(list, ids);
+    if (done) {
+        out << sess.remove_completed(list) << '\n';
+    }
+    if (!ids.empty()) {
+        sess.remove_todos(list, ids);
+    }
+}
+
+void cli::mv(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("list", po::value<string>()->required())
+        ("to", po::value<string>()->required())
+        ("id", po::value<vector<todo_id>>()->required());
+    po::positional_options_description pos;
+    pos.add("list", 1).add("to", 1).add("id", -1);
+    auto vm = parse(command, opts, pos);
+
+    size_t from = require_list(vm["list"].as<string>());
+    const string &title = vm["to"].as<string>();
+    const auto &ids = vm["id"].as<vector<todo_id>>();
+    require_todos(from, ids);
+
+    size_t to = sess.find_list(title).value_or(sess.lists().size());
+    if (to == from)
+        throw runtime_error { format("todos are already in \"{}\"", title) };
+    if (to == sess.lists().size()) {
+        to = sess.create_list(title);
+    }
+    sess.move_todos(from, to, ids);
+}
+
+void cli::find(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("query", po::value<string>()->required())
+        ("list", po::value<vector<string>>());
+    po::positional_options_description pos;
+    pos.add("query", 1).add("list", -1);
+    auto vm = parse(command, opts, pos);
+
+    vector<size_t> lists;
+    if (vm.count("list")) {
+        lists = require_lists(vm["list"].as<vector<string>>());
+    } else {
+        lists.resize(sess.lists().size());
+        iota(begin(lists), end(lists), 0);
+    }
+
+    // Lists are searched in parallel; printing loads them again one by one
+    const string &query = vm["query"].as<string>();
+    const auto found = sess.search(query, lists);
+    size_t total = 0;
+    for (size_t i = 0; i < lists.size(); i++) {
+        if (found[i].empty())
+            continue;
+
+        const todo_list &list = sess.open_list(lists[i]);
+        for (todo_id id : found[i]) {
+            out << sess.lists()[lists[i]].title << '\t' << todo_line(*list.find(id));
+        }
+        total += found[i].size();
+    }
+    if (total == 0)
+        throw runtime_error { format("nothing matches \"{}\"", query) };
+}
+
+void cli::count(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("open", po::bool_switch())
+        ("due-before", po::value<string>())
+        ("list", po::value<vector<string>>());
+    po::positional_options_description pos;
+    pos.add("list", -1);
+    auto vm = parse(command, opts, pos);
+
+    todo_filter filter;
+    if (vm["open"].as<bool>()) {
+        filter.completed = false;
+    }
+    if (vm.count("due-before")) {
+        filter.due_until = parse_time(vm["due-before"].as<string>()) - todo::time_pt::duration { 1 };
+    }
+
+    vector<size_t> lists;
+    if (vm.count("list")) {
+        lists = require_lists(vm["list"].as<vector<string>>());
+    } else {
+        lists.resize(sess.lists().size());
+        iota(begin(lists), end(lists), 0);
+    }
+
+    const auto counts = sess.count_todos(filter, lists);
+    for (size_t i = 0; i < lists.size(); i++) {
+        out << format("{}\t{}\n", sess.lists()[lists[i]].title, counts[i]);
+    }
+    out << format("total\t{}\n", reduce(begin(counts), end(counts), size_t { 0 }));
+}
+
+void cli::due(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("hours", po::value<int>()->default_value(24))
+        ("next", po::bool_switch());
+    auto vm = parse(command, opts, {});
+
+    const bool next_only = vm["next"].as<bool>();
+    const auto now = chrono::system_clock::now();
+    // Overdue first, then whatever falls due within the window; with
+    // --next, the first one of everything due from now on
+    const vector<due_todo> dues = next_only
+        ? sess.deadlines().due_between(now, todo::time_pt::max())
+        : sess.deadlines().due_between(todo::time_pt::min(), now + chrono::hours { vm["hours"].as<int>() });
+
+    // Only the lists with something due are loaded, for the titles. The
+    // index is saved after the shards, so after a crash it can name a list
+    // or todo that is gone, or a todo since completed or moved; those are
+    // skipped.
+    size_t shown = 0;
+    for (const due_todo &d : dues) {
+        const auto index = sess.find_shard(d.list);
+        if (!index)
+            continue;
+
+        const todo_list &list = sess.open_list(*index);
+        const auto it = list.find(d.id);
+        if (it == end(list.get_todos()) || it->is_completed() || it->get_deadline() != d.deadline)
+            continue;
+
+        out << sess.lists()[*index].title << '\t' << todo_line(*it);
+        if (++shown == 1 && next_only)
+            break;
+    }
+    if (shown == 0)
+        throw runtime_error { "nothing is due" };
+}
+
+void cli::export_todos(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("format,f", po::value<string>())
+        ("output,o", po::value<string>())
+        ("list", po::value<vector<string>>());
+    po::positional_options_description pos;
+    pos.add("list", -1);
+    auto vm = parse(command, opts, pos);
+
+    vector<size_t> lists;
+    if (vm.count("list")) {
+        lists = require_lists(vm["list"].as<vector<string>>());
+    }
+
+    const string file = vm.count("output") ? vm["output"].as<string>() : "";
+    ofstream fout;
+    if (!file.empty()) {
+        fout.open(file, ios::binary);
+        if (!fout)
+            throw runtime_error { format("cannot write \"{}\"", file) };
+    }
+    ostream &dest = file.empty() ? out : fout;
+
+    todo_writer writer { dest, pick_format(vm, file) };
+    auto stats = sess.export_todos(writer, lists);
+    if (!dest.flush())
+        throw runtime_error { "write failed" };
+    report(err, "exported", stats);
+}
+
+void cli::import_todos(const args &command) {
+    po::options_description opts;
+    opts.add_options()
+        ("format,f", po::value<string>())
+        ("file", po::value<string>());
+    po::positional_options_description pos;
+    pos.add("file", 1);
+    auto vm = parse(command, opts, pos);
+
+    const string file = vm.count("file") ? vm["file"].as<string>() : "";
+    ifstream fin;
+    if (!file.empty() && file != "-") {
+        fin.open(file, ios::binary);
+        if (!fin)
+            throw runtime_error { format("cannot read \"{}\"", file) };
+    }
+
+    todo_reader reader { fin.is_open() ? fin : cin, pick_format(vm, file) };
+    report(err, "imported", sess.import_todos(reader));
+}
+
+void cli::print_usage() const {
+    err << "Usage:\n"
+           "  p2d add <list> <title> [-d description] [--due \"YYYY-MM-DD HH:MM:SS\"]\n"
+           "  p2d done <list> <id>...\n"
+           "  p2d ls [list] [--due-before \"YYYY-MM-DD HH:MM:SS\"]\n"
+           "  p2d rm <list> [id...] [--done]\n"
+           "  p2d rm <list> --all    remove the whole list\n"
+           "  p2d mv <list> <to> <id>...\n"
+           "  p2d find <text> [list...]\n"
+           "  p2d due [--hours N] [--next]\n"
+           "  p2d count [--open] [--due-before \"YYYY-MM-DD HH:MM:SS\"] [list...]\n"
+           "  p2d export [-f jsonl|csv] [-o file] [list...]\n"
+           "  p2d import [-f jsonl|csv] [file]\n"
+           "  p2d batch    read the commands above from stdin, one per line\n"
+           "Lists are searched and counted on P2D_THREADS threads, one per core by default.\n";
+}
+
+[[nodiscard]] size_t cli::require_list(const string &title) const {
+    if (auto index = sess.find_list(title))
+        return *index;
+    throw runtime_error { format("no list \"{}\"", title) };
+}
+
+void cli::require_todos(size_t list, const vector<todo_id> &ids) {
+    const todo_list &todos = sess.open_list(list);
+    for (todo_id id : ids) {
+        if (todos.find(id) == end(todos.get_todos()))
+            throw runtime_error { format("no todo {} in \"{}\"", id, sess.lists()[list].title) };
+    }
+}
+
+[[nodiscard]] vector<size_t> cli::require_lists(const vector<string> &titles) const {
+    vector<size_t> lists;
+    for (const string &title : titles) {
+        lists.push_back(require_list(title));
+    }
+    return lists;
+}
+}
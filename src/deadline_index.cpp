@@ -0,0 +1,124 @@
+/**
+ *
+ * deadline_index.cpp
+ *
+ * Deadlines of the open todos of every list
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+
+#include "../include/deadline_index.h"
+
+using namespace std;
+
+namespace p2d {
+void deadline_index::add(uint64_t list, const todo &t) {
+    if (t.is_completed() || t.get_deadline() == todo::time_pt::max())
+        return;
+    add({ t.get_deadline(), list, t.get_id() });
+}
+
+void deadline_index::add(const due_todo &due) {
+    auto &dues = by_list[due.list];
+    if (auto old = dues.nodes.find(due.id); old != end(dues.nodes)) {
+        dues.deadlines.erase(dues.deadlines.find(old->second->deadline));
+        by_deadline.erase(old->second);
+    }
+    dues.nodes[due.id] = by_deadline.insert(due).first;
+    dues.deadlines.insert(due.deadline);
+}
+
+void deadline_index::remove(uint64_t list, todo_id id) {
+    auto dues = by_list.find(list);
+    if (dues == end(by_list))
+        return;
+
+    auto &[nodes, deadlines] = dues->second;
+    if (auto it = nodes.find(id); it != end(nodes)) {
+        deadlines.erase(deadlines.find(it->second->deadline));
+        by_deadline.erase(it->second);
+        nodes.erase(it);
+    }
+}
+
+void deadline_index::assign(uint64_t list, const todo_list &todos) {
+    remove_list(list);
+    for (const todo &t : todos.get_todos()) {
+        add(list, t);
+    }
+}
+
+void deadline_index::remove_list(uint64_t list) {
+    auto dues = by_list.find(list);
+    if (dues == end(by_list))
+        return;
+
+    for (auto &[id, node] : dues->second.nodes) {
+        by_deadline.erase(node);
+    }
+    by_list.erase(dues);
+}
+
+void deadline_index::clear() {
+    by_deadline.clear();
+    by_list.clear();
+}
+
+[[nodiscard]] vector<due_todo> deadline_index::due_between(todo::time_pt from, todo::time_pt until) const {
+    // Lists and ids never go below zero, so these bound every deadline
+    auto first = by_deadline.lower_bound({ from, 0, 0 });
+    auto last = by_deadline.lower_bound({ until, 0, 0 });
+    return { first, last };
+}
+
+[[nodiscard]] optional<due_todo> deadline_index::next_due(todo::time_pt from) const {
+    auto it = by_deadline.lower_bound({ from, 0, 0 });
+    if (it == end(by_deadline))
+        return nullopt;
+    return *it;
+}
+
+[[nodiscard]] optional<due_todo> deadline_index::after(const due_todo &due) const {
+    auto it = by_deadline.upper_bound(due);
+    if (it == end(by_deadline))
+        return nullopt;
+    return *it;
+}
+
+[[nodiscard]] vector<due_todo> deadline_index::of_list(uint64_t list) const {
+    vector<due_todo> dues;
+    if (auto found = by_list.find(list); found != end(by_list)) {
+        for (const auto &[id, node] : found->second.nodes) {
+            dues.push_back(*node);
+        }
+    }
+    ranges::sort(dues);
+    return dues;
+}
+
+[[nodiscard]] todo::time_pt deadline_index::earliest(uint64_t list) const {
+    auto dues = by_list.find(list);
+    if (dues == end(by_list) || dues->second.deadlines.empty())
+        return todo::time_pt::max();
+    return *begin(dues->second.deadlines);
+}
+
+[[nodiscard]] size_t deadline_index::size() const {
+    return by_deadline.size();
+}
+
+deadline_watcher::deadline_watcher(deadline_index &index, uint64_t list)
+    : index { index }
+    , list { list } { }
+
+void deadline_watcher::added(const todo &t) {
+    index.add(list, t);
+}
+
+void deadline_watcher::removed(const todo &t) {
+    index.remove(list, t.get_id());
+}
+}
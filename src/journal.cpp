@@ -0,0 +1,584 @@
+/**
+ *
+ * journal.cpp
+ *
+ * Append-only mutation journal for todo lists
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/journal.h"
+
+using namespace std;
+
+namespace p2d {
+namespace {
+    template <typename T>
+        requires is_trivially_copyable_v<T>
+    void put(string &buf, const T &value) {
+        buf.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void put(string &buf, string_view str) {
+        put(buf, static_cast<uint32_t>(str.size()));
+        buf.append(str);
+    }
+
+    // Reads from a record; every getter fails softly on a short buffer
+    class reader {
+    public:
+        reader(string_view data, size_t id_size = sizeof(todo_id))
+            : data { data }
+            , id_size { id_size } { }
+
+        template <typename T>
+        bool get(T &value) {
+            if (data.size() < sizeof(T))
+                return false;
+            memcpy(&value, data.data(), sizeof(T));
+            data.remove_prefix(sizeof(T));
+            return true;
+        }
+
+        // Ids are 32 bits wide in segments from before todo_id
+        bool get_id(todo_id &id) {
+            if (id_size == sizeof(todo_id))
+                return get(id);
+
+            int32_t narrow;
+            if (!get(narrow))
+                return false;
+            id = static_cast<todo_id>(narrow);
+            return true;
+        }
+
+        bool get(optional<todo> &t) {
+            todo_id id;
+            todo::time_pt::rep created, deadline;
+            uint8_t completed;
+            string_view title, description;
+            if (!(get_id(id) && get(created) && get(deadline) && get(completed) && get(title) && get(description)))
+                return false;
+            t.emplace(id, title, description,
+                todo::time_pt { todo::time_pt::duration { created } },
+                todo::time_pt { todo::time_pt::duration { deadline } },
+                completed != 0);
+            return true;
+        }
+
+        // Ids of a bulk record, as a set to test todos against
+        bool get(unordered_set<todo_id> &ids) {
+            uint32_t count;
+            if (!get(count) || data.size() / id_size < count)
+                return false;
+            ids.reserve(count);
+            for (uint32_t i = 0; i < count; i++) {
+                todo_id id;
+                get_id(id);
+                ids.insert(id);
+            }
+            return true;
+        }
+
+        bool get(string_view &str) {
+            uint32_t size;
+            if (!get(size) || data.size() < size)
+                return false;
+            str = data.substr(0, size);
+            data.remove_prefix(size);
+            return true;
+        }
+
+    private:
+        string_view data;
+        size_t id_size;
+    };
+
+    void put(string &buf, const todo &t) {
+        put(buf, t.get_id());
+        put(buf, t.get_created().time_since_epoch().count());
+        put(buf, t.get_deadline().time_since_epoch().count());
+        put(buf, static_cast<uint8_t>(t.is_completed()));
+        put(buf, t.get_title());
+        put(buf, t.get_description());
+    }
+
+    void put(string &buf, const vector<todo_id> &ids) {
+        put(buf, static_cast<uint32_t>(ids.size()));
+        buf.append(reinterpret_cast<const char *>(ids.data()), ids.size() * sizeof(todo_id));
+    }
+
+    void throw_errno(const char *what) {
+        throw system_error { errno, generic_category(), what };
+    }
+}
+
+journal::~journal() {
+    close();
+}
+
+void journal::open(const filesystem::path &base, uint64_t covered) {
+    close();
+    this->base = base;
+    next_lsn = covered + 1;
+
+    // Find the segments left behind by earlier runs
+    segments.clear();
+    const string prefix = base.filename().string() + ".";
+    for (const auto &entry : filesystem::directory_iterator { base.parent_path() }) {
+        const string name = entry.path().filename().string();
+        if (!name.starts_with(prefix))
+            continue;
+
+        uint64_t number;
+        const char *first = name.data() + prefix.size(), *last = name.data() + name.size();
+        if (auto [ptr, ec] = from_chars(first, last, number); ec == errc {} && ptr == last) {
+            segments.push_back(number);
+        }
+    }
+    rng::sort(segments);
+
+    if (segments.empty()) {
+        segments.push_back(1);
+    }
+    // Records are never appended to a segment of an older format
+    if (!open_segment(segments.back())) {
+        rotate();
+    }
+}
+
+void journal::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+
+    // A segment opened ahead but never rotated to holds nothing
+    lock_guard lock { spare_mtx };
+    if (spare_fd >= 0) {
+        ::close(spare_fd);
+        spare_fd = -1;
+        if (spare_bytes == 0) {
+            error_code ec;
+            filesystem::remove(segment_path(spare), ec);
+        }
+    }
+}
+
+size_t journal::replay(const function<void(const record &)> &fn) {
+    size_t count = 0;
+    for (uint64_t number : segments) {
+        count += replay_segment(number, fn);
+    }
+    return count;
+}
+
+size_t journal::replay_segment(uint64_t number, const function<void(const record &)> &fn) {
+    string buf;
+    if (ifstream fin { segment_path(number), ios::binary }) {
+        buf.assign(istreambuf_iterator<char> { fin }, {});
+    }
+
+    // Segments without a header predate todo_id
+    size_t pos = 0;
+    size_t id_size = sizeof(int32_t);
+    if (segment_header head; buf.size() >= sizeof(head)) {
+        memcpy(&head, buf.data(), sizeof(head));
+        if (memcmp(head.magic, magic, sizeof(magic)) == 0) {
+            if (head.version != version)
+                throw runtime_error { "journal: unsupported version" };
+            pos = sizeof(head);
+            id_size = sizeof(todo_id);
+        }
+    }
+
+    size_t count = 0;
+    while (buf.size() - pos >= frame_size) {
+        uint32_t size, sum;
+        memcpy(&size, buf.data() + pos, sizeof(size));
+        memcpy(&sum, buf.data() + pos + sizeof(size), sizeof(sum));
+        if (buf.size() - pos - frame_size < size)
+            break; // torn write
+
+        string_view body { buf.data() + pos + frame_size, size };
+        if (checksum(body) != sum)
+            break; // corrupted tail
+
+        reader rd { body };
+        uint64_t lsn, list;
+        uint8_t type;
+        if (!rd.get(lsn) || !rd.get(type) || !rd.get(list))
+            break;
+
+        fn(record { lsn, static_cast<op>(type), list, body.substr(sizeof(lsn) + sizeof(type) + sizeof(list)), id_size });
+        count++;
+        next_lsn = max(next_lsn, lsn + 1);
+        pos += frame_size + size;
+    }
+
+    // Cut off whatever could not be read so new records follow intact ones.
+    // Only the segment still being appended to can end in a torn record.
+    if (number == current && pos != buf.size()) {
+        if (ftruncate(fd, pos) < 0)
+            throw_errno("journal: ftruncate");
+        bytes = pos - sizeof(segment_header);
+    }
+
+    return count;
+}
+
+uint64_t journal::rotate() {
+    const uint64_t sealed = current;
+
+    int ready = -1;
+    uint64_t ready_bytes = 0;
+    {
+        lock_guard lock { spare_mtx };
+        if (spare_fd >= 0 && spare == sealed + 1) {
+            ready = exchange(spare_fd, -1);
+            ready_bytes = spare_bytes;
+        }
+    }
+
+    if (ready >= 0) {
+        ::close(fd);
+        fd = ready;
+        current = sealed + 1;
+        bytes = ready_bytes;
+    } else {
+        open_segment(sealed + 1);
+    }
+    segments.push_back(current);
+    return sealed;
+}
+
+void journal::prepare(uint64_t number) {
+    uint64_t size;
+    bool intact;
+    int ready = open_file(number, size, intact);
+    if (!intact) {
+        ::close(ready); // rotate() opens it again and moves past it
+        return;
+    }
+
+    lock_guard lock { spare_mtx };
+    if (spare_fd >= 0) {
+        ::close(spare_fd);
+    }
+    spare_fd = ready;
+    spare = number;
+    spare_bytes = size;
+}
+
+[[nodiscard]] uint64_t journal::segment() const {
+    return current;
+}
+
+vector<filesystem::path> journal::release(uint64_t upto) {
+    vector<filesystem::path> paths;
+    while (!segments.empty() && segments.front() <= upto) {
+        paths.push_back(segment_path(segments.front()));
+        segments.erase(begin(segments));
+    }
+    return paths;
+}
+
+void journal::create_list(uint64_t list, string_view title) {
+    string body = begin_record(op::create_list, list);
+    put(body, title);
+    append(body);
+}
+
+void journal::remove_list(uint64_t list) {
+    string body = begin_record(op::remove_list, list);
+    append(body);
+}
+
+void journal::add_todo(uint64_t list, const todo &t) {
+    string body = begin_record(op::add_todo, list);
+    put(body, t);
+    append(body);
+}
+
+void journal::remove_todo(uint64_t list, todo_id id) {
+    string body = begin_record(op::remove_todo, list);
+    put(body, id);
+    append(body);
+}
+
+void journal::mark_completed(uint64_t list, todo_id id) {
+    string body = begin_record(op::mark_completed, list);
+    put(body, id);
+    append(body);
+}
+
+void journal::mark_incomplete(uint64_t list, todo_id id) {
+    string body = begin_record(op::mark_incomplete, list);
+    put(body, id);
+    append(body);
+}
+
+void journal::set_title(uint64_t list, todo_id id, string_view title) {
+    string body = begin_record(op::set_title, list);
+    put(body, id);
+    put(body, title);
+    append(body);
+}
+
+void journal::set_description(uint64_t list, todo_id id, string_view description) {
+    string body = begin_record(op::set_description, list);
+    put(body, id);
+    put(body, description);
+    append(body);
+}
+
+void journal::set_deadline(uint64_t list, todo_id id, const todo::time_pt &deadline) {
+    string body = begin_record(op::set_deadline, list);
+    put(body, id);
+    put(body, deadline.time_since_epoch().count());
+    append(body);
+}
+
+void journal::remove_todos(uint64_t list, const vector<todo_id> &ids) {
+    string body = begin_record(op::remove_todos, list);
+    put(body, ids);
+    append(body);
+}
+
+void journal::set_completed(uint64_t list, const vector<todo_id> &ids, bool completed) {
+    string body = begin_record(op::set_completed, list);
+    put(body, static_cast<uint8_t>(completed));
+    put(body, ids);
+    append(body);
+}
+
+void journal::move_todos(uint64_t from, uint64_t to, const vector<todo_id> &ids, span<const todo> moved) {
+    string body = begin_record(op::move_todos, from);
+    put(body, to);
+    put(body, ids);
+    put(body, static_cast<uint32_t>(moved.size()));
+    for (const todo &t : moved) {
+        put(body, t);
+    }
+    append(body);
+}
+
+[[nodiscard]] uint64_t journal::last_lsn() const {
+    return next_lsn - 1;
+}
+
+[[nodiscard]] uint64_t journal::size() const {
+    return bytes;
+}
+
+bool journal::open_segment(uint64_t number) {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+
+    bool intact;
+    fd = open_file(number, bytes, intact);
+    current = number;
+    return intact;
+}
+
+int journal::open_file(uint64_t number, uint64_t &size, bool &intact) const {
+    int file = ::open(segment_path(number).c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (file < 0)
+        throw_errno("journal: open");
+
+    struct stat st;
+    if (fstat(file, &st) < 0) {
+        ::close(file);
+        throw_errno("journal: fstat");
+    }
+
+    segment_header head {};
+    if (st.st_size == 0) {
+        memcpy(head.magic, magic, sizeof(magic));
+        head.version = version;
+        if (write(file, &head, sizeof(head)) != static_cast<ssize_t>(sizeof(head))) {
+            ::close(file);
+            throw_errno("journal: write");
+        }
+        size = 0;
+        intact = true;
+        return file;
+    }
+
+    size = st.st_size - sizeof(head);
+    intact = pread(file, &head, sizeof(head), 0) == sizeof(head) && memcmp(head.magic, magic, sizeof(magic)) == 0;
+    return file;
+}
+
+[[nodiscard]] filesystem::path journal::segment_path(uint64_t number) const {
+    filesystem::path path = base;
+    path += "." + to_string(number);
+    return path;
+}
+
+string journal::begin_record(op type, uint64_t list) {
+    string body;
+    put(body, next_lsn++);
+    put(body, static_cast<uint8_t>(type));
+    put(body, list);
+    return body;
+}
+
+void journal::append(string &body) {
+    // Frame and body go out in one write(), so a crash leaves at most one
+    // torn record at the end, which replay() detects and drops.
+    string record;
+    record.reserve(frame_size + body.size());
+    put(record, static_cast<uint32_t>(body.size()));
+    put(record, checksum(body));
+    record.append(body);
+
+    if (write(fd, record.data(), record.size()) != static_cast<ssize_t>(record.size()))
+        throw_errno("journal: write");
+    bytes += record.size();
+}
+
+void journal::apply(const record &r, todo_list &target) {
+    reader rd { r.payload, r.id_size };
+    unordered_set<todo_id> ids;
+    auto listed = [&ids](const todo &t) { return ids.contains(t.get_id()); };
+
+    switch (r.type) {
+    case op::add_todo:
+        if (optional<todo> t; rd.get(t)) {
+            target.insert(std::move(*t));
+        }
+        return;
+
+    case op::remove_todos:
+        if (rd.get(ids)) {
+            target.remove_if(listed);
+        }
+        return;
+
+    case op::set_completed:
+        if (uint8_t completed; rd.get(completed) && rd.get(ids)) {
+            target.mark_if(listed, completed != 0);
+        }
+        return;
+
+    case op::move_todos:
+        if (uint64_t to; rd.get(to) && rd.get(ids)) {
+            target.remove_if(listed);
+        }
+        return;
+
+    default:
+        break;
+    }
+
+    todo_id id;
+    if (!rd.get_id(id))
+        return;
+
+    const size_t index = target.position(id);
+    if (index == target.size())
+        return;
+
+    switch (r.type) {
+    case op::remove_todo:
+        target.remove(index);
+        break;
+
+    case op::mark_completed:
+        target.mark_as_completed(index);
+        break;
+
+    case op::mark_incomplete:
+        target.mark_as_incomplete(index);
+        break;
+
+    case op::set_title:
+        if (string_view title; rd.get(title)) {
+            target.update(index, [title](todo &t) {
+                t.set_title(title);
+            });
+        }
+        break;
+
+    case op::set_description:
+        if (string_view description; rd.get(description)) {
+            target.update(index, [description](todo &t) {
+                t.set_description(description);
+            });
+        }
+        break;
+
+    case op::set_deadline:
+        if (todo::time_pt::rep deadline; rd.get(deadline)) {
+            target.update(index, [deadline](todo &t) {
+                t.set_deadline(todo::time_pt { todo::time_pt::duration { deadline } });
+            });
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+[[nodiscard]] uint64_t journal::move_target(const record &r) {
+    reader rd { r.payload };
+    uint64_t to = 0;
+    rd.get(to);
+    return to;
+}
+
+void journal::apply_moved(const record &r, todo_list &target) {
+    reader rd { r.payload, r.id_size };
+    uint64_t to;
+    unordered_set<todo_id> ids;
+    uint32_t count;
+    if (!rd.get(to) || !rd.get(ids) || !rd.get(count))
+        return;
+
+    target.begin_batch();
+    for (uint32_t i = 0; i < count; i++) {
+        optional<todo> t;
+        if (!rd.get(t))
+            break;
+        target.insert(std::move(*t));
+    }
+    target.end_batch();
+}
+
+[[nodiscard]] string_view journal::list_title(const record &r) {
+    reader rd { r.payload };
+    string_view title;
+    rd.get(title);
+    return title;
+}
+
+// FNV-1a, enough to tell a torn or garbled record from an intact one
+uint32_t journal::checksum(string_view data) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+}
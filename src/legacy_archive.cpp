@@ -0,0 +1,113 @@
+/**
+ *
+ * legacy_archive.cpp
+ *
+ * Reader for todo.bin files written before the snapshot format
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <exception>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/binary_object.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include "../include/legacy_archive.h"
+
+using namespace std;
+
+namespace p2d {
+namespace {
+    // Same members, in the same order and at the same class versions, as
+    // the todo and todo_list that wrote the archives
+    struct old_todo {
+        int id;
+        todo::time_pt created;
+        todo::time_pt deadline;
+        string title;
+        string description;
+        bool completed;
+
+        template <typename Archive>
+        void serialize(Archive &ar, const unsigned int version) {
+            ar & id;
+            ar & boost::serialization::make_binary_object(&created, sizeof(created));
+            ar & boost::serialization::make_binary_object(&deadline, sizeof(deadline));
+            ar & title;
+            ar & description;
+            ar & completed;
+        }
+    };
+
+    struct old_list {
+        string title;
+        vector<old_todo> todos;
+
+        template <typename Archive>
+        void serialize(Archive &ar, const unsigned int version) {
+            ar & title;
+            ar & todos;
+        }
+    };
+
+    struct contents {
+        uint64_t lsn = 0;
+        vector<old_list> lists;
+    };
+
+    // Empty unless the layout reads the whole file
+    optional<contents> read(string_view data, bool with_lsn) {
+        try {
+            istringstream in { string { data } };
+            boost::archive::binary_iarchive ia { in };
+
+            contents c;
+            if (with_lsn) {
+                ia >> c.lsn;
+            }
+            ia >> c.lists;
+            if (in.rdbuf()->sgetc() != char_traits<char>::eof())
+                return nullopt;
+            return c;
+        } catch (const exception &) {
+            // A wrong guess reads sizes out of other fields and fails
+            // somewhere; any exception just means the other layout
+            return nullopt;
+        }
+    }
+}
+
+[[nodiscard]] bool legacy_archive::matches(string_view data) {
+    // The signature is a string archived with a 64-bit length in front
+    return data.size() >= sizeof(uint64_t) + signature.size()
+        && data.substr(sizeof(uint64_t), signature.size()) == signature;
+}
+
+uint64_t legacy_archive::load(string_view data, pmr::vector<todo_list> &lists) {
+    optional<contents> c = read(data, true);
+    if (!c) {
+        c = read(data, false);
+    }
+    if (!c)
+        throw runtime_error { "legacy_archive: unreadable todo file" };
+
+    lists.clear();
+    lists.reserve(c->lists.size());
+    for (old_list &old : c->lists) {
+        todo_list &list = lists.emplace_back(old.title);
+        list.begin_batch();
+        for (old_todo &t : old.todos) {
+            list.insert(todo { todo_ids().next(), t.title, t.description, t.created, t.deadline, t.completed });
+        }
+        list.end_batch();
+    }
+    return c->lsn;
+}
+}
@@ -0,0 +1,243 @@
+/**
+ *
+ * search_index.cpp
+ *
+ * Word and trigram index over todo titles and descriptions
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+
+#include "../include/search_index.h"
+
+using namespace std;
+
+namespace p2d {
+namespace {
+    constexpr char fold(char c) {
+        return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+
+    constexpr bool is_word(char c) {
+        return static_cast<unsigned char>(c) >= 0x80
+            || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    // Calls fn with every word of str, case folded into buffer
+    template <typename F>
+    void for_each_word(string_view str, string &buffer, F &&fn) {
+        buffer.resize(str.size());
+        ranges::transform(str, begin(buffer), fold);
+
+        const string_view folded = buffer;
+        for (size_t i = 0; i < folded.size();) {
+            while (i < folded.size() && !is_word(folded[i]))
+                i++;
+            const size_t start = i;
+            while (i < folded.size() && is_word(folded[i]))
+                i++;
+            if (i > start)
+                fn(folded.substr(start, i - start));
+        }
+    }
+
+    // Calls fn with every trigram of word, packed into the low 24 bits
+    template <typename F>
+    void for_each_trigram(string_view word, F &&fn) {
+        for (size_t i = 0; i + search_index::min_piece <= word.size(); i++) {
+            fn(uint32_t { static_cast<unsigned char>(word[i]) } << 16
+                | uint32_t { static_cast<unsigned char>(word[i + 1]) } << 8
+                | static_cast<unsigned char>(word[i + 2]));
+        }
+    }
+
+    // needle is case folded already
+    bool contains(string_view haystack, string_view needle) {
+        if (needle.empty())
+            return true;
+
+        // Jump between the first byte's occurrences in either case with
+        // find(), which is memchr(), and compare the rest only there
+        const char lower = needle[0], upper = lower >= 'a' && lower <= 'z' ? lower - 'a' + 'A' : lower;
+        size_t at_lower = haystack.find(lower);
+        size_t at_upper = lower == upper ? string_view::npos : haystack.find(upper);
+        while (true) {
+            const size_t i = min(at_lower, at_upper);
+            if (i == string_view::npos || i + needle.size() > haystack.size())
+                return false;
+            if (ranges::equal(haystack.substr(i + 1, needle.size() - 1), needle.substr(1), {}, fold))
+                return true;
+
+            if (i == at_lower)
+                at_lower = haystack.find(lower, i + 1);
+            else
+                at_upper = haystack.find(upper, i + 1);
+        }
+    }
+}
+
+search_index::search_index(const allocator_type &alloc)
+    : words { alloc }
+    , word_grams { alloc } { }
+
+search_index::search_index(search_index &&rhs, const allocator_type &alloc)
+    : words { std::move(rhs.words), alloc }
+    , word_grams { alloc } {
+    if (rhs.words.get_allocator() == alloc) {
+        word_grams = std::move(rhs.word_grams);
+        return;
+    }
+
+    // The words were moved into nodes of the new allocator, which the
+    // trigrams of rhs do not point to
+    for (const word_entry &entry : words) {
+        add_grams(entry);
+    }
+    rhs.clear();
+}
+
+void search_index::add(const todo &t) {
+    string buffer;
+    for (string_view field : { t.get_title(), t.get_description() }) {
+        for_each_word(field, buffer, [&](string_view word) {
+            add_word(word, t.get_id());
+        });
+    }
+}
+
+void search_index::remove(const todo &t) {
+    string buffer;
+    for (string_view field : { t.get_title(), t.get_description() }) {
+        for_each_word(field, buffer, [&](string_view word) {
+            remove_word(word, t.get_id());
+        });
+    }
+}
+
+void search_index::clear() {
+    words.clear();
+    word_grams.clear();
+}
+
+[[nodiscard]] optional<vector<todo_id>> search_index::candidates(string_view query) const {
+    optional<vector<todo_id>> result;
+    string buffer;
+    for_each_word(query, buffer, [&](string_view piece) {
+        if (piece.size() < min_piece || (result && result->empty()))
+            return;
+
+        vector<todo_id> ids = containing(piece);
+        if (!result) {
+            result = std::move(ids);
+            return;
+        }
+        vector<todo_id> both;
+        ranges::set_intersection(*result, ids, back_inserter(both));
+        result = std::move(both);
+    });
+    return result;
+}
+
+[[nodiscard]] bool search_index::exact(string_view query) {
+    return query.size() >= min_piece && ranges::all_of(query, is_word);
+}
+
+[[nodiscard]] string search_index::fold_case(string_view query) {
+    string folded { query };
+    ranges::transform(folded, begin(folded), fold);
+    return folded;
+}
+
+[[nodiscard]] bool search_index::matches(const todo &t, string_view folded) {
+    return contains(t.get_title(), folded) || contains(t.get_description(), folded);
+}
+
+void search_index::add_word(string_view word, todo_id id) {
+    auto it = words.find(word);
+    if (it == end(words)) {
+        it = words.emplace(word, posting {}).first;
+        add_grams(*it);
+    }
+
+    // New todos have the largest id, so this is nearly always an append.
+    // A word seen twice in the todo finds id already there.
+    posting &ids = it->second;
+    if (ids.empty() || ids.back() < id) {
+        ids.push_back(id);
+    } else if (auto pos = ranges::lower_bound(ids, id); *pos != id) {
+        ids.insert(pos, id);
+    }
+}
+
+void search_index::add_grams(const word_entry &entry) {
+    for_each_trigram(entry.first, [&](trigram gram) {
+        auto &entries = word_grams[gram];
+        if (entries.empty() || entries.back() != &entry) // a trigram repeated in word
+            entries.push_back(&entry);
+    });
+}
+
+void search_index::remove_word(string_view word, todo_id id) {
+    auto it = words.find(word);
+    if (it == end(words))
+        return;
+
+    // Gone already if the word is in the todo more than once
+    posting &ids = it->second;
+    if (auto pos = ranges::lower_bound(ids, id); pos != end(ids) && *pos == id) {
+        ids.erase(pos);
+    }
+    if (!ids.empty())
+        return;
+
+    // No todo uses the word anymore
+    for_each_trigram(word, [&](trigram gram) {
+        auto grams = word_grams.find(gram);
+        if (grams == end(word_grams))
+            return; // a trigram repeated in word, dropped already
+
+        auto &entries = grams->second;
+        if (auto entry = ranges::find(entries, &*it); entry != end(entries)) {
+            *entry = entries.back();
+            entries.pop_back();
+        }
+        if (entries.empty()) {
+            word_grams.erase(grams);
+        }
+    });
+    words.erase(it);
+}
+
+[[nodiscard]] vector<todo_id> search_index::containing(string_view piece) const {
+    // Every word containing piece is listed under each of its trigrams, so
+    // the rarest one has them all
+    const pmr::vector<const word_entry *> *rarest = nullptr;
+    bool missing = false;
+    for_each_trigram(piece, [&](trigram gram) {
+        auto it = word_grams.find(gram);
+        if (it == end(word_grams))
+            missing = true;
+        else if (!rarest || it->second.size() < rarest->size())
+            rarest = &it->second;
+    });
+    if (missing || !rarest)
+        return {};
+
+    vector<todo_id> ids;
+    size_t matched = 0;
+    for (const word_entry *entry : *rarest) {
+        if (entry->first.find(piece) != string::npos) {
+            ids.insert(end(ids), begin(entry->second), end(entry->second));
+            matched++;
+        }
+    }
+    // One posting is sorted already; more have to be merged
+    if (matched > 1) {
+        ranges::sort(ids);
+        ids.erase(ranges::unique(ids).begin(), end(ids));
+    }
+    return ids;
+}
+}
@@ -10,8 +10,20 @@
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
+#include <cctype>
+#include <cstdlib>
+#include <format>
 #include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_set>
 
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "../include/atomic_file.h"
 #include "../include/session.h"
 
 using namespace std;
@@ -19,153 +31,700 @@ using namespace boost::archive;
 namespace fs = std::filesystem;
 
 namespace p2d {
-session::session(ui_manager &ui)
-    : ui { ui } {
+namespace {
+    // P2D_THREADS, or one per core if unset
+    size_t pool_threads() {
+        const char *threads = getenv("P2D_THREADS");
+        return threads ? strtoul(threads, nullptr, 10) : 0;
+    }
+
+    // P2D_KDF_ITERATIONS, the cost new passwords are stored at
+    uint32_t kdf_iterations() {
+        const char *iterations = getenv("P2D_KDF_ITERATIONS");
+        const unsigned long n = iterations ? strtoul(iterations, nullptr, 10) : 0;
+        return n ? static_cast<uint32_t>(n) : password::default_iterations;
+    }
+
+    // A user id as a file name: ASCII letters, digits, '_', '-' and
+    // non-leading '.' stay, every other byte becomes %XX. The empty id of a
+    // login.bin from before ids becomes a lone %, which no other id gives.
+    string file_name(string_view id) {
+        if (id.empty())
+            return "%";
+
+        string name;
+        for (size_t i = 0; i < id.size(); i++) {
+            const unsigned char c = id[i];
+            if (isalnum(c) || c == '_' || c == '-' || (c == '.' && i > 0))
+                name += c;
+            else
+                name += format("%{:02X}", c);
+        }
+        return name;
+    }
+}
+
+session::session(ui_manager &ui, checkpoint_options options)
+    : session { options } {
+    this->ui = &ui;
+}
+
+session::session(checkpoint_options options)
+    : options { options }
+    , last_checkpoint { chrono::steady_clock::now() }
+    , workers { pool_threads() } {
     data_path = fs::path { getenv("HOME") } / ".local" / "share" / "p2d";
     if (!fs::exists(data_path)) {
         fs::create_directories(data_path);
-        return;
     }
 
+    // Todos are read only for the user in login.bin, if any; otherwise
+    // run() reads them after the login
     load_login();
     load_user();
     load_todo();
 }
 
 session::~session() {
+    // Only releases; whatever close() did not save is lost, apart from the
+    // todo edits, which are in the journal already
+    checkpoints.stop();
+    todo_log.close();
+    unlock_partition();
+}
+
+void session::close() {
     save_login();
     save_user();
-    save_todo();
+
+    // Edits are already in the journal; fold them in only once it is large,
+    // or if a background checkpoint failed and left shards unwritten
+    checkpoints.stop();
+    if (todo_loaded && (checkpoints.failed() || todo_log.size() > options.journal_bytes)) {
+        save_todo();
+    }
+
+    // Not before the journal is closed, which can still remove a segment
+    todo_log.close();
+    unlock_partition();
 }
 
 void session::load_login() {
-    if (fs::exists(data_path / login_file)) {
-        ifstream fin { data_path / login_file, ios::binary };
-        auto size = file_size(fin);
-
-        string buf(size, '\0');
-        fin.read(&buf[0], size);
-        parse_binary_login(buf);
+    if (filebuf fin; fin.open(data_path / login_file, ios::in | ios::binary)) {
+        parse_binary_login(fin);
     }
 }
 
 void session::load_user() {
-    if (fs::exists(data_path / user_file)) {
-        ifstream fin { data_path / user_file, ios::binary };
-        auto size = file_size(fin);
-
-        string buf(size, '\0');
-        fin.read(&buf[0], size);
-        parse_binary_user(buf);
+    if (filebuf fin; fin.open(data_path / user_file, ios::in | ios::binary)) {
+        parse_binary_user(fin);
     }
 }
 
 void session::load_todo() {
-    if (fs::exists(data_path / todo_file)) {
-        ifstream fin { data_path / todo_file, ios::binary };
-        auto size = file_size(fin);
+    if (!current_user || todo_loaded)
+        return;
+
+    const fs::path partition = partition_path(current_user->get_id());
+    const bool fresh = !fs::exists(partition);
+    if (fresh) {
+        fs::create_directories(partition);
+    }
+    // Two processes would append the same lsns to one journal, and each
+    // checkpoint would drop the lists and segments of the other
+    lock_partition(partition);
+    if (fresh) {
+        adopt_shared(partition);
+    }
+
+    // Only the index is read here; shards follow when a list is opened,
+    // or right away if the journal holds edits for them.
+    uint64_t covered = todo_lists.open(partition / todo_dir);
+    if (fs::exists(partition / legacy_file)) {
+        covered = todo_lists.import(partition / legacy_file, workers);
+    }
+    todo_log.open(partition / journal_file, covered);
+    todo_log.replay([this](const journal::record &r) {
+        todo_lists.apply(r);
+    });
+    todo_lists.refresh();
+    todo_loaded = true;
+}
+
+[[nodiscard]] fs::path session::partition_path(string_view id) const {
+    return data_path / user_dir / file_name(id);
+}
+
+void session::adopt_shared(const fs::path &partition) {
+    // The index and shards, or the single file from before them, then
+    // every journal segment
+    if (fs::exists(data_path / todo_dir)) {
+        fs::rename(data_path / todo_dir, partition / todo_dir);
+    }
+    if (fs::exists(data_path / legacy_file)) {
+        fs::rename(data_path / legacy_file, partition / legacy_file);
+    }
+    for (const auto &entry : fs::directory_iterator { data_path }) {
+        const string name = entry.path().filename().string();
+        if (name.starts_with(journal_file)) {
+            fs::rename(entry.path(), partition / name);
+        }
+    }
+}
 
-        string buf(size, '\0');
-        fin.read(&buf[0], size);
-        parse_binary_todo(buf);
+void session::lock_partition(const fs::path &partition) {
+    partition_lock = ::open(partition.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (partition_lock < 0)
+        throw system_error { errno, generic_category(), "session: open" };
+
+    if (flock(partition_lock, LOCK_EX | LOCK_NB) < 0) {
+        int err = errno;
+        unlock_partition();
+        if (err == EWOULDBLOCK)
+            throw runtime_error { format("p2d: the todos of {} are open in another p2d; try again once it exits",
+                current_user->get_id()) };
+        throw system_error { err, generic_category(), "session: flock" };
+    }
+}
+
+void session::unlock_partition() {
+    if (partition_lock >= 0) {
+        ::close(partition_lock); // releases the flock
+        partition_lock = -1;
     }
 }
 
 void session::save_login() {
-    if (current_user) {
-        ofstream fout { data_path / login_file, ios::binary };
-        fout << serialize_login();
+    if (current_user && login_dirty) {
+        atomic_file fout { data_path / login_file };
+        serialize_login(fout);
+        fout.commit();
+        login_dirty = false;
     }
 }
 
 void session::save_user() {
-    ofstream fout { data_path / user_file, ios::binary };
-    fout << serialize_user();
+    if (all_users.is_dirty()) {
+        atomic_file fout { data_path / user_file };
+        serialize_user(fout);
+        fout.commit();
+        all_users.mark_clean();
+    }
 }
 
 void session::save_todo() {
-    ofstream fout { data_path / todo_file, ios::binary };
-    fout << serialize_todo();
+    checkpointer::run(capture_todo(checkpoints.failed()));
 }
 
 void session::run() {
+    if (!ui)
+        throw logic_error { "session: run() needs a ui_manager" };
+
     if (!current_user) {
-        ui.login(current_user, all_users);
+        authenticator auth { all_users, workers, kdf_iterations() };
+        ui->login(current_user, all_users, auth);
+        if (!current_user) {
+            close(); // keeps a registration made before leaving
+            return;
+        }
+
+        login_dirty = true;
+        load_todo();
     }
+    // Checkpoints after the first open the segment they rotate to next
+    todo_log.prepare(todo_log.segment() + 1);
 
     while (true) {
-        // Main page: show all lists
-        if (auto ret = ui.show_all_lists(todo_lists); ret.second == 0)
+        maybe_checkpoint();
+
+        // Main page: show all lists, rendered from the index alone
+        if (auto ret = ui->show_all_lists(todo_lists.lists()); ret.second == 0)
             break; // if quit
         else if (ret.second < 0) {
-            ui.create_list(todo_lists);
+            string title = ui->create_list();
+            todo_log.create_list(todo_lists.create(title), title);
+            continue;
+        }
+        else if (todo_lists.size() == 0) {
             continue;
         }
         else if (ret.first == "remove") {
-            todo_lists.erase(begin(todo_lists) + ui.list_selected_index());
+            todo_log.remove_list(todo_lists.remove(ui->list_selected_index()));
+            continue;
+        }
+        else if (ret.first == "agenda") {
+            run_agenda();
             continue;
         }
 
+        // Load the selected shard, making room by evicting others
+        const size_t list_index = ui->list_selected_index();
+        const uint64_t shard = todo_lists.lists()[list_index].shard;
+        auto list = &todo_lists.get(list_index);
+        todo_lists.trim(list_index, checkpoints.settled());
+
         while (true) {
+            maybe_checkpoint();
+
             // Show the selected list
-            auto list = begin(todo_lists) + ui.list_selected_index();
-            if (auto ret = ui.list_memos(*list); ret.second == 0)
+            auto ret = ui->list_memos(*list);
+            if (ret.second == 0)
                 break; // if back
             else if (ret.second < 0) {
-                ui.create_memo(*list);
+                int index = ui->create_memo(*list);
+                todo_log.add_todo(shard, (*list)[index]);
+                continue;
+            }
+            else if (ret.first == "sort") {
+                // Only the view changes; nothing to journal
+                list->sort(next_order(list->get_order()));
+                continue;
+            }
+            else if (list->empty()) {
+                continue;
+            }
+            else if (ret.first == "clear") {
+                remove_completed(list_index);
+                continue;
+            }
+            else if (ret.first == "remove_marked") {
+                remove_todos(list_index, ui->marked());
+                ui->clear_marks();
+                continue;
+            }
+            else if (ret.first == "check_marked" || ret.first == "uncheck_marked") {
+                complete_todos(list_index, ui->marked(), ret.first == "check_marked");
                 continue;
             }
-            else if (ret.first == "remove") {
-                list->remove(ui.memo_selected_index());
+            else if (ret.first == "move_marked") {
+                if (const string &title = ui->move_target(); !title.empty()) {
+                    const size_t to = find_list(title).value_or(todo_lists.size());
+                    move_todos(list_index, to == todo_lists.size() ? create_list(title) : to, ui->marked());
+                    ui->clear_marks();
+                }
+                continue;
+            }
+
+            const todo_id memo_id = (*list)[ui->memo_selected_index()].get_id();
+            if (ret.first == "remove") {
+                list->remove(ui->memo_selected_index());
+                todo_log.remove_todo(shard, memo_id);
                 continue;
             }
             else if (ret.first == "check") {
-                list->mark_as_completed(ui.memo_selected_index());
+                list->mark_as_completed(ui->memo_selected_index());
+                todo_log.mark_completed(shard, memo_id);
                 continue;
             }
             else if (ret.first == "uncheck") {
-                list->mark_as_incomplete(ui.memo_selected_index());
+                list->mark_as_incomplete(ui->memo_selected_index());
+                todo_log.mark_incomplete(shard, memo_id);
                 continue;
             }
 
-            // Show the selected memo
-            auto memo = begin(list->get_todos()) + ui.memo_selected_index();
-            ui.interact_memo(*memo);
+            // Show a copy of the selected memo, so that only an edited
+            // description is journaled and goes through the list, which
+            // keeps the search index in step
+            const todo &shown = (*list)[ui->memo_selected_index()];
+            todo memo { memo_id, shown.get_title(), shown.get_description(),
+                shown.get_created(), shown.get_deadline(), shown.is_completed() };
+            ui->interact_memo(memo);
+            if (memo.get_description() != shown.get_description()) {
+                list->update(ui->memo_selected_index(), [&](todo &edited) {
+                    edited.set_description(memo.get_description());
+                });
+                todo_log.set_description(shard, memo_id, memo.get_description());
+            }
+        }
+
+        todo_lists.refresh(list_index);
+    }
+
+    close();
+}
+
+void session::run_agenda() {
+    // The agenda loads lists as its rows are drawn and trims right after,
+    // so it stays within the budget however many lists there are
+    while (true) {
+        maybe_checkpoint();
+
+        agenda rows { todo_lists, checkpoints.settled() };
+        auto ret = ui->show_agenda(rows, todo_lists.lists());
+        if (ret.second == 0)
+            break; // if back
+        else if (rows.empty()) {
+            continue;
+        }
+
+        // A checked todo leaves the agenda when it is made again
+        const agenda_row &row = rows[ui->agenda_selected_index()];
+        if (ret.first == "check" && row.found) {
+            complete_todo(row.list, row.id);
         }
     }
 }
 
-[[nodiscard]] std::string session::serialize_login() const {
-    return serialize(*current_user);
+[[nodiscard]] const vector<list_info> &session::lists() const {
+    return todo_lists.lists();
 }
 
-[[nodiscard]] std::string session::serialize_user() const {
-    return serialize(all_users);
+[[nodiscard]] optional<size_t> session::find_list(string_view title) const {
+    const auto &all = todo_lists.lists();
+    if (auto it = rng::find(all, title, &list_info::title); it != end(all))
+        return distance(begin(all), it);
+    return nullopt;
 }
 
-[[nodiscard]] std::string session::serialize_todo() const {
-    return serialize(todo_lists);
+[[nodiscard]] const deadline_index &session::deadlines() const {
+    return todo_lists.deadlines();
 }
 
-void session::parse_binary_login(const std::string &data) {
+[[nodiscard]] optional<size_t> session::find_shard(uint64_t shard) const {
+    const auto &all = todo_lists.lists();
+    if (auto it = rng::find(all, shard, &list_info::shard); it != end(all))
+        return distance(begin(all), it);
+    return nullopt;
+}
+
+[[nodiscard]] const todo_list &session::open_list(size_t index) {
+    const todo_list &list = todo_lists.get(index);
+    todo_lists.trim(index, checkpoints.settled());
+    return list;
+}
+
+size_t session::create_list(string_view title) {
+    todo_log.create_list(todo_lists.create(title), title);
+    maybe_checkpoint();
+    return todo_lists.size() - 1;
+}
+
+void session::remove_list(size_t index) {
+    todo_log.remove_list(todo_lists.remove(index));
+    maybe_checkpoint();
+}
+
+todo_id session::add_todo(size_t list, string_view title, string_view description, const todo::time_pt &deadline) {
+    todo_list &target = todo_lists.get(list);
+    int index = target.add(title, description, deadline);
+    const todo &added = target[index];
+
+    todo_log.add_todo(todo_lists.lists()[list].shard, added);
+    const todo_id id = added.get_id();
+    todo_lists.refresh(list);
+    maybe_checkpoint();
+    return id;
+}
+
+bool session::complete_todo(size_t list, todo_id id) {
+    todo_list &target = todo_lists.get(list);
+    const size_t pos = target.position(id);
+    if (pos == target.size())
+        return false;
+
+    target.mark_as_completed(pos);
+    todo_log.mark_completed(todo_lists.lists()[list].shard, id);
+    todo_lists.refresh(list);
+    maybe_checkpoint();
+    return true;
+}
+
+bool session::remove_todo(size_t list, todo_id id) {
+    todo_list &target = todo_lists.get(list);
+    const size_t pos = target.position(id);
+    if (pos == target.size())
+        return false;
+
+    target.remove(pos);
+    todo_log.remove_todo(todo_lists.lists()[list].shard, id);
+    todo_lists.refresh(list);
+    maybe_checkpoint();
+    return true;
+}
+
+size_t session::complete_todos(size_t list, const vector<todo_id> &ids, bool completed) {
+    const unordered_set<todo_id> wanted { begin(ids), end(ids) };
+    const vector<todo_id> changed = todo_lists.get(list).mark_if([&](const todo &t) {
+        return wanted.contains(t.get_id());
+    }, completed);
+    if (changed.empty())
+        return 0;
+
+    todo_log.set_completed(todo_lists.lists()[list].shard, changed, completed);
+    todo_lists.refresh(list);
+    maybe_checkpoint();
+    return changed.size();
+}
+
+size_t session::remove_todos(size_t list, const vector<todo_id> &ids) {
+    const unordered_set<todo_id> wanted { begin(ids), end(ids) };
+    const vector<todo_id> removed = todo_lists.get(list).remove_if([&](const todo &t) {
+        return wanted.contains(t.get_id());
+    });
+    if (removed.empty())
+        return 0;
+
+    todo_log.remove_todos(todo_lists.lists()[list].shard, removed);
+    todo_lists.refresh(list);
+    maybe_checkpoint();
+    return removed.size();
+}
+
+size_t session::remove_completed(size_t list) {
+    const vector<todo_id> removed = todo_lists.get(list).remove_if([](const todo &t) {
+        return t.is_completed();
+    });
+    if (removed.empty())
+        return 0;
+
+    todo_log.remove_todos(todo_lists.lists()[list].shard, removed);
+    todo_lists.refresh(list);
+    maybe_checkpoint();
+    return removed.size();
+}
+
+size_t session::move_todos(size_t from, size_t to, const vector<todo_id> &ids) {
+    if (from == to)
+        return 0;
+
+    // Loading the target never evicts the source, so both stay in place
+    todo_list &source = todo_lists.get(from);
+    todo_list &target = todo_lists.get(to);
+
+    const unordered_set<todo_id> wanted { begin(ids), end(ids) };
+    pmr::vector<todo> taken = source.extract_if([&](const todo &t) {
+        return wanted.contains(t.get_id());
+    });
+    if (taken.empty())
+        return 0;
+
+    vector<todo_id> left;
+    left.reserve(taken.size());
+    for (const todo &t : taken) {
+        left.push_back(t.get_id());
+    }
+
+    // add_range() appends, so the moved todos end the target's storage
+    target.add_range(taken);
+    const span moved = span { target.get_todos() }.last(taken.size());
+    todo_log.move_todos(todo_lists.lists()[from].shard, todo_lists.lists()[to].shard, left, moved);
+
+    todo_lists.refresh(from);
+    todo_lists.refresh(to);
+    maybe_checkpoint();
+    return moved.size();
+}
+
+transfer_stats session::export_todos(todo_writer &out, const vector<size_t> &lists) {
+    const auto start = chrono::steady_clock::now();
+    const auto before = out.count();
+
+    auto write_list = [&](size_t index) {
+        const string &title = todo_lists.lists()[index].title;
+        for (const todo &t : open_list(index).view()) {
+            out.write(title, t);
+        }
+    };
+    if (lists.empty()) {
+        for (size_t i = 0; i < todo_lists.size(); i++) {
+            write_list(i);
+        }
+    } else {
+        rng::for_each(lists, write_list);
+    }
+
+    return { out.count() - before,
+        chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start) };
+}
+
+[[nodiscard]] vector<vector<todo_id>> session::search(string_view query, const vector<size_t> &lists) {
+    const vector<size_t> targets = every_list(lists);
+    vector<vector<todo_id>> found(targets.size());
+    for_each_list(targets, [&](size_t i, const todo_list &list) {
+        found[i] = list.search(query);
+    });
+    return found;
+}
+
+[[nodiscard]] vector<size_t> session::count_todos(const todo_filter &filter, const vector<size_t> &lists) {
+    const vector<size_t> targets = every_list(lists);
+    vector<size_t> counts(targets.size());
+    for_each_list(targets, [&](size_t i, const todo_list &list) {
+        // Inline when lists run side by side; in chunks for a lone list
+        counts[i] = list.count(filter, workers);
+    });
+    return counts;
+}
+
+transfer_stats session::import_todos(todo_reader &in) {
+    const auto start = chrono::steady_clock::now();
+    transfer_stats stats;
+
+    todo_row row;
+    optional<size_t> current;
+    todo_list *list = nullptr;
+    uint64_t shard = 0;
+    size_t pending = 0;
+
+    // Lists stay in a batch until the next flush, however the rows
+    // alternate between them. Having taken rows, they are dirty and so
+    // never evicted in the meantime.
+    vector<pair<size_t, todo_list *>> batching;
+    unordered_set<size_t> in_batch;
+
+    // Sorts what every list took in, the lists in parallel, and lets a
+    // checkpoint run if it is due
+    auto flush = [&] {
+        workers.for_each(batching.size(), [&](size_t i) {
+            batching[i].second->end_batch();
+        });
+        for (const auto &[index, batched] : batching) {
+            todo_lists.refresh(index);
+        }
+        batching.clear();
+        in_batch.clear();
+        pending = 0;
+        maybe_checkpoint();
+    };
+    auto start_batch = [&] {
+        list = &todo_lists.get(*current);
+        shard = todo_lists.lists()[*current].shard;
+        todo_lists.trim(*current, checkpoints.settled());
+        if (in_batch.insert(*current).second) {
+            list->begin_batch();
+            batching.emplace_back(*current, list);
+        }
+    };
+
+    try {
+        while (in.next(row)) {
+            if (!current || todo_lists.lists()[*current].title != row.list) {
+                current = find_list(row.list);
+                if (!current) {
+                    // Not create_list(), whose checkpoint would catch the
+                    // other lists mid-batch
+                    todo_log.create_list(todo_lists.create(row.list), row.list);
+                    current = todo_lists.size() - 1;
+                }
+                start_batch();
+            }
+
+            // Rows keep the ids they were exported with, so the same todo
+            // has the same id on every instance it was imported into. Ids
+            // are unique across lists, so one held by any list is replaced;
+            // the shards whose id range covers it are loaded to tell.
+            if (row.id != 0 && !todo_lists.contains(row.id)) {
+                list->insert(todo { row.id, row.title, row.description, row.created, row.deadline, row.completed });
+            } else {
+                list->add(row.title, row.description, row.created, row.deadline, row.completed);
+            }
+            todo_log.add_todo(shard, list->get_todos().back()); // batches only append
+            if (todo_lists.over_budget()) {
+                todo_lists.trim(*current, checkpoints.settled());
+            }
+            stats.records++;
+
+            if (++pending == import_batch) {
+                flush();
+                start_batch();
+            }
+        }
+    } catch (...) {
+        // Rows before the bad one stay imported; they are already journaled
+        flush();
+        throw;
+    }
+    flush();
+
+    stats.elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+    return stats;
+}
+
+[[nodiscard]] bool session::logged_in() const {
+    return todo_loaded;
+}
+
+[[nodiscard]] checkpoint_metrics session::checkpoint_stats() const {
+    return checkpoints.metrics();
+}
+
+void session::serialize_login(std::streambuf &out) const {
+    serialize(out, *current_user);
+}
+
+void session::serialize_user(std::streambuf &out) const {
+    serialize(out, all_users);
+}
+
+void session::parse_binary_login(std::streambuf &in) {
     user u;
-    parse_binary(u, data);
+    parse_binary(in, u);
     current_user = make_unique<user>(move(u));
 }
 
-void session::parse_binary_user(const std::string &data) {
-    parse_binary(all_users, data);
+void session::parse_binary_user(std::streambuf &in) {
+    parse_binary(in, all_users);
 }
 
-void session::parse_binary_todo(const std::string &data) {
-    parse_binary(todo_lists, data);
+template <typename F>
+void session::for_each_list(const vector<size_t> &lists, F &&fn) {
+    // The store is not thread safe, so lists are loaded here a group at a
+    // time; only the work on a loaded group is spread over the workers
+    const size_t group = workers.size() * 4;
+    vector<const todo_list *> loaded;
+    for (size_t first = 0; first < lists.size(); first += group) {
+        const size_t last = min(first + group, lists.size());
+        loaded.clear();
+        for (size_t i = first; i < last; i++) {
+            loaded.push_back(&todo_lists.get(lists[i]));
+        }
+
+        workers.for_each(loaded.size(), [&](size_t i) {
+            fn(first + i, *loaded[i]);
+        });
+        todo_lists.trim(lists[last - 1], checkpoints.settled());
+    }
 }
 
-[[nodiscard]] std::streamsize session::file_size(std::ifstream &fin) const {
-    fin.seekg(0, ios::end);
-    auto size = fin.tellg();
-    fin.seekg(0, ios::beg);
+[[nodiscard]] vector<size_t> session::every_list(const vector<size_t> &lists) const {
+    if (!lists.empty())
+        return lists;
+
+    vector<size_t> all(todo_lists.size());
+    iota(begin(all), end(all), 0);
+    return all;
+}
 
-    return size;
+void session::maybe_checkpoint() {
+    if (todo_log.size() == 0 || checkpoints.busy() || checkpoints.failed())
+        return;
+
+    const auto now = chrono::steady_clock::now();
+    if (todo_log.size() < options.journal_bytes
+        && now - last_checkpoint < options.interval
+        && !todo_lists.over_budget())
+        return;
+
+    // Encoding happens here, while nothing else touches the lists, and
+    // only for lists edited since the last checkpoint: about 0.2 ms per
+    // thousand todos, split over the workers. The fsyncs and renames, and
+    // opening the segment the next checkpoint rotates to, happen on the
+    // checkpointer thread.
+    checkpoint_job job = capture_todo(false);
+    job.then = [this, next = todo_log.segment() + 1] { todo_log.prepare(next); };
+    checkpoints.submit(move(job));
+    last_checkpoint = now;
+}
+
+checkpoint_job session::capture_todo(bool everything) {
+    checkpoint_job job;
+    job.id = ++last_job;
+
+    const uint64_t lsn = todo_log.last_lsn();
+    const uint64_t sealed = todo_log.rotate();
+    todo_lists.capture(lsn, job, workers, everything);
+    rng::move(todo_log.release(sealed), back_inserter(job.obsolete));
+
+    return job;
+}
 }
-}
\ No newline at end of file
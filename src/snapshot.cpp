@@ -0,0 +1,240 @@
+/**
+ *
+ * snapshot.cpp
+ *
+ * Flat, memory-mapped on-disk format for todo lists
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/atomic_file.h"
+#include "../include/legacy_archive.h"
+#include "../include/snapshot.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace p2d {
+namespace {
+    template <typename T>
+    T read_record(string_view data, uint64_t offset) {
+        T record;
+        memcpy(&record, data.data() + offset, sizeof(T));
+        return record;
+    }
+
+    string_view slice(string_view data, uint64_t offset, uint64_t size) {
+        if (offset > data.size() || size > data.size() - offset)
+            throw runtime_error { "snapshot: string out of bounds" };
+        return data.substr(offset, size);
+    }
+
+    todo::time_pt to_time(int64_t count) {
+        return todo::time_pt { todo::time_pt::duration { count } };
+    }
+
+    // Same interface as atomic_file, collecting into memory instead
+    struct string_sink {
+        string &out;
+
+        void write(const void *data, size_t size) {
+            out.append(static_cast<const char *>(data), size);
+        }
+
+        void write(string_view str) {
+            out.append(str);
+        }
+
+        template <typename T>
+        void write_record(const T &record) {
+            write(&record, sizeof(T));
+        }
+    };
+}
+
+///////// MAPPED FILE //////////
+mapped_file::mapped_file(const fs::path &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw system_error { errno, generic_category(), "snapshot: open" };
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        throw system_error { err, generic_category(), "snapshot: fstat" };
+    }
+
+    length = st.st_size;
+    if (length > 0) {
+        addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            throw system_error { err, generic_category(), "snapshot: mmap" };
+        }
+    }
+    close(fd); // the mapping stays valid on its own
+}
+
+mapped_file::~mapped_file() {
+    if (addr) {
+        munmap(addr, length);
+    }
+}
+
+[[nodiscard]] string_view mapped_file::data() const {
+    return { static_cast<const char *>(addr), length };
+}
+
+///////// SNAPSHOT //////////
+uint64_t snapshot::load(const fs::path &path, pmr::vector<todo_list> &lists) {
+    auto file = make_shared<const mapped_file>(path);
+    string_view data = file->data();
+
+    // Written before this format; the lists stay dirty, so the next
+    // checkpoint writes them out in it
+    if (legacy_archive::matches(data))
+        return legacy_archive::load(data, lists);
+
+    if (data.size() < sizeof(header))
+        throw runtime_error { "snapshot: file too small" };
+
+    auto head = read_record<header>(data, 0);
+    if (memcmp(head.magic, magic, sizeof(magic)) != 0)
+        throw runtime_error { "snapshot: not a p2d todo file" };
+    if (head.version != version)
+        throw runtime_error { "snapshot: unsupported version" };
+
+    const uint64_t lists_offset = sizeof(header);
+    const uint64_t todos_offset = lists_offset + uint64_t { head.list_count } * sizeof(list_record);
+    if (todos_offset > data.size())
+        throw runtime_error { "snapshot: list table out of bounds" };
+    const uint64_t todo_total = (data.size() - todos_offset) / sizeof(todo_record);
+
+    lists.clear();
+    lists.reserve(head.list_count);
+    for (uint32_t i = 0; i < head.list_count; i++) {
+        auto lr = read_record<list_record>(data, lists_offset + i * sizeof(list_record));
+        if (lr.first_todo > todo_total || lr.todo_count > todo_total - lr.first_todo)
+            throw runtime_error { "snapshot: todo table out of bounds" };
+
+        todo_list &list = lists.emplace_back(slice(data, lr.title_offset, lr.title_size));
+        list.backing = file;
+        list.dirty = false;
+        list.todos.reserve(lr.todo_count);
+
+        // Records are stored in the order the list was viewed in, so
+        // rebuilding its default view usually needs no sorting
+        todo_id newest = 0;
+        for (uint32_t j = 0; j < lr.todo_count; j++) {
+            auto tr = read_record<todo_record>(data, todos_offset + (lr.first_todo + j) * sizeof(todo_record));
+
+            todo t { list.get_allocator() };
+            t.id = static_cast<todo_id>(tr.id);
+            t.created = to_time(tr.created);
+            t.deadline = to_time(tr.deadline);
+            t.title = text::borrow(slice(data, tr.title_offset, tr.title_size));
+            t.description = text::borrow(slice(data, tr.description_offset, tr.description_size));
+            t.completed = tr.completed != 0;
+
+            newest = max(newest, t.id);
+            list.todos.push_back(std::move(t));
+        }
+        todo_ids().observe(newest);
+        list.rebuild();
+    }
+
+    return head.lsn;
+}
+
+void snapshot::save(const fs::path &path, span<const todo_list> lists, uint64_t lsn) {
+    // Never rewritten in place: the live mapping of the old file must not
+    // see its contents change underneath it.
+    atomic_file fout { path };
+    write(fout, lists, lsn);
+    fout.commit();
+}
+
+string snapshot::encode(span<const todo_list> lists, uint64_t lsn) {
+    string out;
+    string_sink sink { out };
+    write(sink, lists, lsn);
+    return out;
+}
+
+template <typename Sink>
+void snapshot::write(Sink &fout, span<const todo_list> lists, uint64_t lsn) {
+    uint64_t todo_total = 0;
+    for (const auto &list : lists) {
+        todo_total += list.todos.size();
+    }
+
+    const uint64_t strings_offset = sizeof(header)
+        + lists.size() * sizeof(list_record)
+        + todo_total * sizeof(todo_record);
+
+    header head {};
+    memcpy(head.magic, magic, sizeof(magic));
+    head.version = version;
+    head.lsn = lsn;
+    head.list_count = lists.size();
+    fout.write_record(head);
+
+    // Both tables are laid out first, so string offsets are assigned in the
+    // same order the strings are written out below.
+    uint64_t next_string = strings_offset;
+    uint64_t next_todo = 0;
+    for (const auto &list : lists) {
+        list_record lr {};
+        lr.title_offset = next_string;
+        lr.title_size = list.title.size();
+        lr.first_todo = next_todo;
+        lr.todo_count = list.todos.size();
+        fout.write_record(lr);
+
+        next_string += list.title.size();
+        next_todo += list.todos.size();
+    }
+
+    for (const auto &list : lists) {
+        for (const todo &t : list.view()) {
+            string_view title = t.title, description = t.description;
+
+            todo_record tr {};
+            tr.id = static_cast<int64_t>(t.id);
+            tr.created = t.created.time_since_epoch().count();
+            tr.deadline = t.deadline.time_since_epoch().count();
+            tr.title_offset = next_string;
+            tr.title_size = title.size();
+            tr.description_offset = next_string + title.size();
+            tr.description_size = description.size();
+            tr.completed = t.completed;
+            fout.write_record(tr);
+
+            next_string += title.size() + description.size();
+        }
+    }
+
+    for (const auto &list : lists) {
+        fout.write(list.title);
+    }
+    for (const auto &list : lists) {
+        for (const todo &t : list.view()) {
+            fout.write(t.title);
+            fout.write(t.description);
+        }
+    }
+}
+}
@@ -0,0 +1,116 @@
+/**
+ *
+ * task_pool.cpp
+ *
+ * Worker threads that split work over lists or chunks of a list
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <utility>
+
+#include "../include/task_pool.h"
+
+using namespace std;
+
+namespace p2d {
+namespace {
+    // Set while a thread runs a task, so that a nested loop runs inline
+    // instead of waiting on workers that are all busy with the outer one
+    thread_local bool in_task = false;
+}
+
+task_pool::task_pool(size_t threads) {
+    if (threads == 0) {
+        threads = max(thread::hardware_concurrency(), 1u);
+    }
+    workers.reserve(threads - 1);
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(&task_pool::loop, this);
+    }
+}
+
+task_pool::~task_pool() {
+    {
+        lock_guard lock { mtx };
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+[[nodiscard]] size_t task_pool::size() const {
+    return workers.size() + 1;
+}
+
+void task_pool::run(size_t n, task fn, void *ctx) {
+    // A single item stays on this thread, which leaves it free to split
+    // its own work in turn
+    if (n <= 1 || workers.empty() || in_task) {
+        for (size_t i = 0; i < n; i++) {
+            fn(ctx, i);
+        }
+        return;
+    }
+
+    {
+        lock_guard lock { mtx };
+        job = fn;
+        job_ctx = ctx;
+        job_size = n;
+        next = 0;
+        busy = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    drain();
+
+    unique_lock lock { mtx };
+    done.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+    if (error) {
+        rethrow_exception(exchange(error, nullptr));
+    }
+}
+
+void task_pool::drain() {
+    in_task = true;
+    for (size_t i; (i = next.fetch_add(1)) < job_size;) {
+        try {
+            job(job_ctx, i);
+        } catch (...) {
+            lock_guard lock { mtx };
+            if (!error) {
+                error = current_exception();
+            }
+            next = job_size;
+        }
+    }
+    in_task = false;
+}
+
+void task_pool::loop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            unique_lock lock { mtx };
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        drain();
+
+        lock_guard lock { mtx };
+        if (--busy == 0) {
+            done.notify_one();
+        }
+    }
+}
+}
@@ -14,28 +14,38 @@
 
 using namespace std;
 
-namespace p2d::order {
+namespace p2d {
+text::text(const allocator_type &alloc)
+    : owned { alloc } { }
 
-bool by_deadline::operator()(const todo &lhs, const todo &rhs) const {
-    return lhs.get_deadline() < rhs.get_deadline();
-}
+text::text(string_view str, const allocator_type &alloc)
+    : owned { str, alloc } { }
 
-bool by_created::operator()(const todo &lhs, const todo &rhs) const {
-    return lhs.get_created() < rhs.get_created();
-}
+text::text(text &&rhs, const allocator_type &alloc)
+    : owned { std::move(rhs.owned), alloc }
+    , borrowed { rhs.borrowed }
+    , borrowing { rhs.borrowing } { }
 
-bool by_completed::operator()(const todo &lhs, const todo &rhs) const {
-    return lhs.is_completed() < rhs.is_completed();
+[[nodiscard]] text text::borrow(string_view mapped) {
+    text t;
+    t.borrowed = mapped;
+    t.borrowing = true;
+    return t;
 }
 
-bool by_title::operator()(const todo &lhs, const todo &rhs) const {
-    return lhs.get_title() < rhs.get_title();
+text &text::operator=(string_view str) {
+    owned = str;
+    borrowed = {};
+    borrowing = false;
+    return *this;
 }
+
+[[nodiscard]] bool text::is_borrowed() const {
+    return borrowing;
 }
 
-namespace p2d {
 // Constructors
-todo::todo(int id, string_view title, string_view description, const time_pt &deadline)
+todo::todo(todo_id id, string_view title, string_view description, const time_pt &deadline)
     : id { id }
     , title { title }
     , description { description }
@@ -43,7 +53,7 @@ todo::todo(int id, string_view title, string_view description, const time_pt &de
     created = chrono::system_clock::now();
 }
 
-todo::todo(int id, string_view title, string_view description, const time_pt &created, const time_pt &deadline, const bool completed)
+todo::todo(todo_id id, string_view title, string_view description, const time_pt &created, const time_pt &deadline, const bool completed)
     : id { id }
     , title { title }
     , description { description }
@@ -51,46 +61,47 @@ todo::todo(int id, string_view title, string_view description, const time_pt &cr
     , deadline { deadline }
     , completed { completed } { }
 
-// Getters
-[[nodiscard]] int todo::get_id() const {
-    return id;
-}
+todo::todo(todo &&rhs, const allocator_type &alloc)
+    : id { rhs.id }
+    , created { rhs.created }
+    , deadline { rhs.deadline }
+    , title { std::move(rhs.title), alloc }
+    , description { std::move(rhs.description), alloc }
+    , completed { rhs.completed }
+    , dirty { rhs.dirty } { }
 
-[[nodiscard]] const string &todo::get_title() const {
-    return title;
-}
+todo::todo(const allocator_type &alloc)
+    : title { alloc }
+    , description { alloc } { }
 
-[[nodiscard]] const string &todo::get_description() const {
+// Getters
+[[nodiscard]] string_view todo::get_description() const {
     return description;
 }
 
-[[nodiscard]] const todo::time_pt &todo::get_created() const {
-    return created;
-}
-
-[[nodiscard]] const todo::time_pt &todo::get_deadline() const {
-    return deadline;
-}
-
-[[nodiscard]] bool todo::is_completed() const {
-    return completed;
+[[nodiscard]] bool todo::is_dirty() const {
+    return dirty;
 }
 
 // Setters
 void todo::set_title(string_view title) {
     this->title = title;
+    dirty = true;
 }
 
 void todo::set_description(string_view description) {
     this->description = description;
+    dirty = true;
 }
 
 void todo::set_deadline(const time_pt &deadline) {
     this->deadline = deadline;
+    dirty = true;
 }
 
 void todo::set_completed(bool completed) {
     this->completed = completed;
+    dirty = true;
 }
 
 ostream &operator<<(ostream &os, const todo &td) {
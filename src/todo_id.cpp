@@ -0,0 +1,70 @@
+/**
+ *
+ * todo_id.cpp
+ *
+ * Time-ordered 64-bit todo ids
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include "../include/todo_id.h"
+
+using namespace std;
+
+namespace p2d {
+id_generator::id_generator(uint16_t node)
+    : node_id { static_cast<uint16_t>(node & node_mask) } { }
+
+[[nodiscard]] todo_id id_generator::next() {
+    const auto now = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch());
+    const uint64_t stamp = (max<uint64_t>(now.count(), epoch) - epoch) << time_shift;
+
+    // The sequence may not carry into the node bits, so a full millisecond
+    // moves on to the next one instead
+    uint64_t prev = last.load(memory_order_relaxed);
+    uint64_t taken;
+    do {
+        if (stamp > prev) {
+            taken = stamp;
+        } else if ((prev & sequence_mask) < sequence_mask) {
+            taken = prev + 1;
+        } else {
+            taken = ((prev >> time_shift) + 1) << time_shift;
+        }
+    } while (!last.compare_exchange_weak(prev, taken, memory_order_relaxed));
+
+    return taken | (uint64_t { node_id.load(memory_order_relaxed) } << sequence_bits);
+}
+
+void id_generator::observe(todo_id id) {
+    const uint64_t seen = id & ~(node_mask << sequence_bits);
+    uint64_t prev = last.load(memory_order_relaxed);
+    while (seen > prev && !last.compare_exchange_weak(prev, seen, memory_order_relaxed)) { }
+}
+
+[[nodiscard]] todo_id id_generator::latest() const {
+    return last.load(memory_order_relaxed) | (uint64_t { node() } << sequence_bits);
+}
+
+[[nodiscard]] uint16_t id_generator::node() const {
+    return node_id.load(memory_order_relaxed);
+}
+
+void id_generator::set_node(uint16_t node) {
+    node_id.store(node & node_mask, memory_order_relaxed);
+}
+
+[[nodiscard]] uint64_t id_generator::millis(todo_id id) {
+    const uint64_t time = id >> time_shift;
+    return time == 0 ? 0 : time + epoch;
+}
+
+[[nodiscard]] id_generator &todo_ids() {
+    static id_generator ids;
+    return ids;
+}
+}
@@ -8,64 +8,445 @@
  *
  */
 
+#include <atomic>
+#include <numeric>
 #include <sstream>
+#include <utility>
 
 #include "../include/todo_list.h"
 
 using namespace std;
 
 namespace p2d {
-todo_list::todo_list(string_view title)
-    : title { title } { }
+namespace {
+    // Shared by every list, so that no two states of any lists share one
+    atomic<uint64_t> revisions = 0;
 
-[[nodiscard]] string &todo_list::get_title() {
-    return title;
+    template <typename View, size_t... I>
+    array<View, sizeof...(I)> make_views(const todo_list::allocator_type &alloc, index_sequence<I...>) {
+        return { ((void)I, View(alloc))... };
+    }
+
+    template <typename View, size_t... I>
+    array<View, sizeof...(I)> move_views(array<View, sizeof...(I)> &views, const todo_list::allocator_type &alloc, index_sequence<I...>) {
+        return { View(std::move(views[I]), alloc)... };
+    }
+
+    // todo_filter in terms of the hot columns. Evaluated without branches,
+    // so loops over it vectorize.
+    struct hot_filter {
+        using rep = todo::time_pt::rep;
+
+        rep due_from, due_until;
+        rep created_from, created_until;
+        uint8_t either, wanted;
+
+        explicit hot_filter(const todo_filter &filter)
+            : due_from { filter.due_from.time_since_epoch().count() }
+            , due_until { filter.due_until.time_since_epoch().count() }
+            , created_from { filter.created_from.time_since_epoch().count() }
+            , created_until { filter.created_until.time_since_epoch().count() }
+            , either { !filter.completed.has_value() }
+            , wanted { filter.completed.value_or(false) } { }
+
+        bool operator()(rep deadline, rep created, uint8_t completed) const {
+            return (deadline >= due_from) & (deadline <= due_until)
+                & (created >= created_from) & (created <= created_until)
+                & (either | (completed == wanted));
+        }
+    };
 }
 
-[[nodiscard]] vector<todo> &todo_list::get_todos() {
-    return todos;
+[[nodiscard]] string_view order_name(todo_order order) {
+    switch (order) {
+    case todo_order::deadline: return "deadline";
+    case todo_order::created: return "created";
+    case todo_order::completed: return "completed";
+    case todo_order::title: return "title";
+    }
+    return "";
 }
 
-[[nodiscard]] const string &todo_list::get_title() const {
+[[nodiscard]] todo_order next_order(todo_order order) {
+    return static_cast<todo_order>((static_cast<size_t>(order) + 1) % todo_order_count);
+}
+
+template <typename F>
+decltype(auto) todo_list::with_ordering(todo_order order, F &&fn) {
+    switch (order) {
+    case todo_order::created: return std::forward<F>(fn)(ordering_of<todo_order::created> {});
+    case todo_order::completed: return std::forward<F>(fn)(ordering_of<todo_order::completed> {});
+    case todo_order::title: return std::forward<F>(fn)(ordering_of<todo_order::title> {});
+    default: return std::forward<F>(fn)(ordering_of<todo_order::deadline> {});
+    }
+}
+
+template <typename Compare>
+[[nodiscard]] auto todo_list::by_index(Compare cmp) const {
+    return [this, cmp](uint32_t a, uint32_t b) {
+        return cmp(todos[a], todos[b]);
+    };
+}
+
+todo_list::todo_list(string_view title, const allocator_type &alloc)
+    : title { title, alloc }
+    , todos { alloc }
+    , views { make_views<view_type>(alloc, make_index_sequence<todo_order_count> {}) }
+    , positions { alloc }
+    , hot { alloc }
+    , text_index { alloc } {
+    built[index_of(active)] = true;
+}
+
+todo_list::todo_list(todo_list &&rhs, const allocator_type &alloc)
+    : title { std::move(rhs.title), alloc }
+    , todos { std::move(rhs.todos), alloc }
+    , views { move_views<view_type>(rhs.views, alloc, make_index_sequence<todo_order_count> {}) }
+    , built { rhs.built }
+    , active { rhs.active }
+    , positions { std::move(rhs.positions), alloc }
+    , hot { std::move(rhs.hot), alloc }
+    , hot_built { rhs.hot_built }
+    , text_index { std::move(rhs.text_index), alloc }
+    , text_built { rhs.text_built }
+    , watcher { rhs.watcher }
+    , backing { std::move(rhs.backing) }
+    , dirty { rhs.dirty }
+    , batching { rhs.batching }
+    , indexed { rhs.indexed }
+    , text_size { rhs.text_size } { }
+
+[[nodiscard]] todo &todo_list::operator[](size_t pos) {
+    return todos[views[index_of(active)][pos]];
+}
+
+[[nodiscard]] const todo &todo_list::operator[](size_t pos) const {
+    return todos[views[index_of(active)][pos]];
+}
+
+[[nodiscard]] pmr::string &todo_list::get_title() {
+    return title;
+}
+
+[[nodiscard]] const pmr::string &todo_list::get_title() const {
     return title;
 }
 
-[[nodiscard]] const vector<todo> &todo_list::get_todos() const {
+[[nodiscard]] const pmr::vector<todo> &todo_list::get_todos() const {
     return todos;
 }
 
+[[nodiscard]] todo_list::allocator_type todo_list::get_allocator() const {
+    return todos.get_allocator();
+}
+
+[[nodiscard]] size_t todo_list::size() const {
+    return todos.size();
+}
+
+[[nodiscard]] bool todo_list::empty() const {
+    return todos.empty();
+}
+
+[[nodiscard]] size_t todo_list::text_bytes() const {
+    return text_size;
+}
+
 // here id is id of todo
-[[nodiscard]] vector<todo>::iterator todo_list::find(int id) {
-    return rng::find_if(todos, [id](todo &t) {
-        return t.id == id;
+[[nodiscard]] pmr::vector<todo>::iterator todo_list::find(todo_id id) {
+    auto it = positions.find(id);
+    return it == end(positions) ? end(todos) : begin(todos) + it->second;
+}
+
+[[nodiscard]] pmr::vector<todo>::const_iterator todo_list::find(todo_id id) const {
+    auto it = positions.find(id);
+    return it == end(positions) ? end(todos) : begin(todos) + it->second;
+}
+
+[[nodiscard]] size_t todo_list::position(todo_id id) const {
+    auto it = positions.find(id);
+    if (it == end(positions))
+        return size();
+
+    const view_type &view = views[index_of(active)];
+    return with_ordering(active, [&](auto cmp) -> size_t {
+        return distance(begin(view), lower_bound(begin(view), end(view), it->second, by_index(cmp)));
     });
 }
 
-[[nodiscard]] vector<todo>::const_iterator todo_list::find(int id) const {
-    return rng::find_if(todos, [id](const todo &t) {
-        return t.id == id;
+[[nodiscard]] size_t todo_list::count(const todo_filter &filter) const {
+    build_hot();
+    const hot_filter matches { filter };
+    const auto *deadline = hot.deadline.data();
+    const auto *created = hot.created.data();
+    const auto *completed = hot.completed.data();
+
+    size_t count = 0;
+    for (size_t i = 0, n = hot.deadline.size(); i < n; i++) {
+        count += matches(deadline[i], created[i], completed[i]);
+    }
+    return count;
+}
+
+[[nodiscard]] size_t todo_list::count(const todo_filter &filter, task_pool &pool) const {
+    build_hot(); // before the chunks read the columns
+    const hot_filter matches { filter };
+    const auto *deadline = hot.deadline.data();
+    const auto *created = hot.created.data();
+    const auto *completed = hot.completed.data();
+
+    atomic<size_t> count = 0;
+    pool.for_each_chunk(hot.deadline.size(), scan_grain, [&](size_t first, size_t last) {
+        size_t found = 0;
+        for (size_t i = first; i < last; i++) {
+            found += matches(deadline[i], created[i], completed[i]);
+        }
+        count += found;
     });
+    return count;
+}
+
+[[nodiscard]] vector<todo_id> todo_list::select(const todo_filter &filter) const {
+    build_hot();
+    const hot_filter matches { filter };
+    const auto *deadline = hot.deadline.data();
+    const auto *created = hot.created.data();
+    const auto *completed = hot.completed.data();
+
+    // Scan in storage order first, then pick the hits out in view order
+    vector<uint8_t> mask(todos.size());
+    for (size_t i = 0; i < mask.size(); i++) {
+        mask[i] = matches(deadline[i], created[i], completed[i]);
+    }
+
+    vector<todo_id> ids;
+    for (uint32_t index : views[index_of(active)]) {
+        if (mask[index]) {
+            ids.push_back(hot.id[index]);
+        }
+    }
+    return ids;
+}
+
+[[nodiscard]] vector<todo_id> todo_list::search(string_view query) const {
+    build_text();
+    const string folded = search_index::fold_case(query);
+    const bool exact = search_index::exact(query);
+
+    vector<uint32_t> hits;
+    if (auto candidates = text_index.candidates(query)) {
+        for (todo_id id : *candidates) {
+            const uint32_t index = positions.find(id)->second;
+            if (exact || search_index::matches(todos[index], folded))
+                hits.push_back(index);
+        }
+    } else {
+        // Too short to look up
+        for (uint32_t i = 0; i < todos.size(); i++) {
+            if (search_index::matches(todos[i], folded))
+                hits.push_back(i);
+        }
+    }
+
+    // A few hits are sorted into the current order; many are picked out
+    // of the view instead
+    vector<todo_id> ids;
+    ids.reserve(hits.size());
+    if (hits.size() * 16 < todos.size()) {
+        with_ordering(active, [&](auto cmp) {
+            rng::sort(hits, by_index(cmp));
+        });
+        for (uint32_t index : hits) {
+            ids.push_back(todos[index].id);
+        }
+    } else {
+        vector<uint8_t> mask(todos.size());
+        for (uint32_t index : hits) {
+            mask[index] = true;
+        }
+        for (uint32_t index : views[index_of(active)]) {
+            if (mask[index])
+                ids.push_back(todos[index].id);
+        }
+    }
+    return ids;
+}
+
+int todo_list::insert(todo &&new_todo) {
+    todo_ids().observe(new_todo.id);
+    dirty = true;
+
+    const auto index = static_cast<uint32_t>(todos.size());
+    positions[new_todo.id] = index;
+    todos.push_back(std::move(new_todo));
+    store_hot(index);
+    track(index);
+    if (batching) {
+        return index;
+    }
+
+    indexed = todos.size();
+    return attach(index);
 }
 
-// here id is index of todo
+void todo_list::begin_batch() {
+    batching = true;
+}
+
+void todo_list::end_batch() {
+    if (batching) {
+        batching = false;
+        index_tail();
+    }
+}
+
+// here id is position of todo
 bool todo_list::remove(int id) {
-    todos.erase(begin(todos) + id);
+    const uint32_t index = detach(id);
+    positions.erase(todos[index].id);
+
+    // The last todo fills the hole, so only its view entries change
+    const auto last = static_cast<uint32_t>(todos.size() - 1);
+    if (index != last) {
+        for (size_t o = 0; o < todo_order_count; o++) {
+            if (built[o]) {
+                *locate(static_cast<todo_order>(o), last) = index;
+            }
+        }
+        todos[index] = std::move(todos[last]);
+        positions[todos[index].id] = index;
+        store_hot(index);
+    }
+    todos.pop_back();
+    if (hot_built) {
+        hot.pop_back();
+    }
+    indexed = todos.size();
+
+    dirty = true;
     return true;
 }
 
-void todo_list::sort(compare_by cmp) {
-    rng::sort(todos, cmp);
+vector<todo_id> todo_list::erase_matching(const vector<uint8_t> &matched, pmr::vector<todo> *taken) {
+    index_tail();
+
+    // Survivors slide down over the gaps, keeping their relative order,
+    // so every view only needs its entries renumbered
+    vector<todo_id> ids;
+    vector<uint32_t> moved_to(todos.size());
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < todos.size(); i++) {
+        if (matched[i]) {
+            untrack(i);
+            ids.push_back(todos[i].id);
+            positions.erase(todos[i].id);
+            if (taken) {
+                // The snapshot a borrowed text points into stays with this list
+                todo &out = taken->emplace_back(std::move(todos[i]));
+                for (text *t : { &out.title, &out.description }) {
+                    if (t->is_borrowed()) {
+                        *t = string_view { *t };
+                    }
+                }
+            }
+            continue;
+        }
+
+        if (kept != i) {
+            todos[kept] = std::move(todos[i]);
+            positions[todos[kept].id] = kept;
+            store_hot(kept);
+        }
+        moved_to[i] = kept++;
+    }
+    if (ids.empty())
+        return ids;
+
+    todos.erase(begin(todos) + kept, end(todos));
+    if (hot_built) {
+        hot.resize(kept);
+    }
+    for (size_t o = 0; o < todo_order_count; o++) {
+        if (built[o]) {
+            view_type &view = views[o];
+            std::erase_if(view, [&](uint32_t index) { return matched[index]; });
+            for (uint32_t &index : view) {
+                index = moved_to[index];
+            }
+        }
+    }
+    indexed = todos.size();
+
+    dirty = true;
+    return ids;
+}
+
+vector<todo_id> todo_list::complete_matching(const vector<uint8_t> &matched, bool completed) {
+    index_tail();
+
+    vector<todo_id> ids;
+    for (uint32_t i = 0; i < todos.size(); i++) {
+        if (!matched[i] || todos[i].completed == completed)
+            continue;
+
+        untrack(i);
+        todos[i].completed = completed;
+        todos[i].dirty = true;
+        store_hot(i);
+        track(i);
+        ids.push_back(todos[i].id);
+    }
+    if (ids.empty())
+        return ids;
+
+    // One sort per view instead of a move per todo; the views whose
+    // ordering ignores completion are still sorted and cost one check
+    for (size_t o = 0; o < todo_order_count; o++) {
+        if (!built[o])
+            continue;
+
+        view_type &view = views[o];
+        with_ordering(static_cast<todo_order>(o), [&](auto cmp) {
+            if (!is_sorted(begin(view), end(view), by_index(cmp))) {
+                std::sort(begin(view), end(view), by_index(cmp));
+            }
+        });
+    }
+
+    dirty = true;
+    return ids;
+}
+
+void todo_list::watch(todo_watcher *watcher) {
+    this->watcher = watcher;
+}
+
+void todo_list::sort(todo_order order) {
+    index_tail();
+    if (!built[index_of(order)]) {
+        build(order);
+    }
+    active = order;
+    revision = next_revision();
+}
+
+[[nodiscard]] todo_order todo_list::get_order() const {
+    return active;
 }
 
 bool todo_list::mark_as_completed(int id) {
-    todo &todo = todos[id];
-    todo.completed = true;
+    update(id, [](todo &t) {
+        t.completed = true;
+        t.dirty = true;
+    });
     return true;
 }
 
 bool todo_list::mark_as_incomplete(int id) {
-    todo &todo = todos[id];
-    todo.completed = false;
+    update(id, [](todo &t) {
+        t.completed = false;
+        t.dirty = true;
+    });
     return true;
 }
 
@@ -74,7 +455,242 @@ bool todo_list::clear() {
         return false;
     }
 
+    if (watcher) {
+        for (const todo &t : todos) {
+            watcher->removed(t);
+        }
+    }
     todos.clear();
+    positions.clear();
+    hot.clear();
+    text_index.clear();
+    for (auto &view : views) {
+        view.clear();
+    }
+    indexed = 0;
+    text_size = 0;
+    dirty = true;
+    revision = next_revision();
     return true;
 }
-}
\ No newline at end of file
+
+[[nodiscard]] bool todo_list::is_dirty() const {
+    return dirty;
+}
+
+[[nodiscard]] uint64_t todo_list::get_revision() const {
+    return revision;
+}
+
+void todo_list::mark_clean() {
+    dirty = false;
+    for (todo &t : todos) {
+        t.dirty = false;
+    }
+}
+
+todo_list::hot_columns::hot_columns(const allocator_type &alloc)
+    : id { alloc }
+    , deadline { alloc }
+    , created { alloc }
+    , completed { alloc } { }
+
+todo_list::hot_columns::hot_columns(hot_columns &&rhs, const allocator_type &alloc)
+    : id { std::move(rhs.id), alloc }
+    , deadline { std::move(rhs.deadline), alloc }
+    , created { std::move(rhs.created), alloc }
+    , completed { std::move(rhs.completed), alloc } { }
+
+void todo_list::hot_columns::assign(size_t index, const todo &t) {
+    id[index] = t.id;
+    deadline[index] = t.deadline.time_since_epoch().count();
+    created[index] = t.created.time_since_epoch().count();
+    completed[index] = t.completed;
+}
+
+void todo_list::hot_columns::push_back(const todo &t) {
+    id.push_back(t.id);
+    deadline.push_back(t.deadline.time_since_epoch().count());
+    created.push_back(t.created.time_since_epoch().count());
+    completed.push_back(t.completed);
+}
+
+void todo_list::hot_columns::pop_back() {
+    id.pop_back();
+    deadline.pop_back();
+    created.pop_back();
+    completed.pop_back();
+}
+
+void todo_list::hot_columns::resize(size_t size) {
+    id.resize(size);
+    deadline.resize(size);
+    created.resize(size);
+    completed.resize(size);
+}
+
+void todo_list::hot_columns::clear() {
+    id.clear();
+    deadline.clear();
+    created.clear();
+    completed.clear();
+}
+
+void todo_list::store_hot(uint32_t index) {
+    if (!hot_built)
+        return;
+
+    if (index == hot.id.size())
+        hot.push_back(todos[index]);
+    else
+        hot.assign(index, todos[index]);
+}
+
+void todo_list::build_hot() const {
+    if (hot_built)
+        return;
+
+    hot.clear();
+    hot.id.reserve(todos.size());
+    hot.deadline.reserve(todos.size());
+    hot.created.reserve(todos.size());
+    hot.completed.reserve(todos.size());
+    for (const todo &t : todos) {
+        hot.push_back(t);
+    }
+    hot_built = true;
+}
+
+void todo_list::build_text() const {
+    if (text_built)
+        return;
+
+    text_index.clear();
+    for (const todo &t : todos) {
+        text_index.add(t);
+    }
+    text_built = true;
+}
+
+void todo_list::track(uint32_t index) {
+    revision = next_revision();
+    text_size += todos[index].get_title().size() + todos[index].get_description().size();
+    if (text_built) {
+        text_index.add(todos[index]);
+    }
+    if (watcher) {
+        watcher->added(todos[index]);
+    }
+}
+
+void todo_list::untrack(uint32_t index) {
+    revision = next_revision();
+    text_size -= todos[index].get_title().size() + todos[index].get_description().size();
+    if (text_built) {
+        text_index.remove(todos[index]);
+    }
+    if (watcher) {
+        watcher->removed(todos[index]);
+    }
+}
+
+uint32_t todo_list::detach(size_t pos) {
+    index_tail();
+    const uint32_t index = views[index_of(active)][pos];
+    untrack(index);
+    for (size_t o = 0; o < todo_order_count; o++) {
+        if (built[o]) {
+            views[o].erase(locate(static_cast<todo_order>(o), index));
+        }
+    }
+    return index;
+}
+
+int todo_list::attach(uint32_t index) {
+    int pos = 0;
+    for (size_t o = 0; o < todo_order_count; o++) {
+        if (!built[o])
+            continue;
+
+        const auto order = static_cast<todo_order>(o);
+        view_type &view = views[o];
+        auto it = with_ordering(order, [&](auto cmp) {
+            return view.insert(upper_bound(begin(view), end(view), index, by_index(cmp)), index);
+        });
+        if (order == active) {
+            pos = distance(begin(view), it);
+        }
+    }
+    return pos;
+}
+
+void todo_list::index_tail() {
+    if (indexed == todos.size())
+        return;
+
+    for (size_t o = 0; o < todo_order_count; o++) {
+        if (!built[o])
+            continue;
+
+        // Sort only the new todos, then merge them in
+        view_type &view = views[o];
+        const size_t old_size = view.size();
+        for (size_t i = indexed; i < todos.size(); i++) {
+            view.push_back(i);
+        }
+        with_ordering(static_cast<todo_order>(o), [&](auto cmp) {
+            std::sort(begin(view) + old_size, end(view), by_index(cmp));
+            inplace_merge(begin(view), begin(view) + old_size, end(view), by_index(cmp));
+        });
+    }
+    indexed = todos.size();
+}
+
+void todo_list::build(todo_order order) {
+    view_type &view = views[index_of(order)];
+    view.resize(todos.size());
+    iota(begin(view), end(view), 0u);
+
+    // Snapshots store todos in the order they were viewed in
+    with_ordering(order, [&](auto cmp) {
+        if (!is_sorted(begin(view), end(view), by_index(cmp))) {
+            std::sort(begin(view), end(view), by_index(cmp));
+        }
+    });
+    built[index_of(order)] = true;
+}
+
+void todo_list::rebuild() {
+    positions.clear();
+    positions.reserve(todos.size());
+    text_size = 0;
+    for (size_t i = 0; i < todos.size(); i++) {
+        positions[todos[i].id] = i;
+        text_size += todos[i].get_title().size() + todos[i].get_description().size();
+    }
+
+    built = {};
+    for (auto &view : views) {
+        view.clear();
+    }
+    build(active);
+    hot.clear();
+    hot_built = false;
+    text_index.clear();
+    text_built = false;
+    indexed = todos.size();
+    revision = next_revision();
+}
+
+[[nodiscard]] uint64_t todo_list::next_revision() {
+    return revisions.fetch_add(1, memory_order_relaxed) + 1;
+}
+
+[[nodiscard]] todo_list::view_type::iterator todo_list::locate(todo_order order, uint32_t index) {
+    // Views are totally ordered, so the entry is exactly where index sorts
+    view_type &view = views[index_of(order)];
+    return with_ordering(order, [&](auto cmp) {
+        return lower_bound(begin(view), end(view), index, by_index(cmp));
+    });
+}
+}
@@ -0,0 +1,468 @@
+/**
+ *
+ * todo_store.cpp
+ *
+ * Sharded on-disk storage of todo lists
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include "../include/snapshot.h"
+#include "../include/todo_store.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace p2d {
+namespace {
+    // Index layout: header, one entry per list, the titles back to back,
+    // then each list's open deadlines in the same order as the lists.
+    // Version 1 has neither the deadlines nor due_count. Versions before 3
+    // have 32-bit todo ids and no id generator state in the header, and
+    // versions before 4 no id ranges.
+    constexpr char index_magic[4] = { 'P', '2', 'D', 'I' };
+    constexpr uint32_t index_version = 4;
+
+    struct index_header {
+        char magic[4];
+        uint32_t version;
+        uint64_t lsn;
+        uint64_t next_shard;
+        uint32_t list_count;
+        uint32_t node; // of the ids made here
+        uint64_t last_id; // no id made here is below it
+    };
+
+    struct index_entry {
+        uint64_t shard;
+        int64_t next_deadline;
+        uint32_t todo_count;
+        uint32_t title_size;
+        uint32_t due_count;
+        uint32_t reserved;
+        uint64_t min_id;
+        uint64_t max_id;
+    };
+
+    struct due_record {
+        int64_t deadline;
+        uint64_t id; // int32 and 4 zero bytes before version 3
+    };
+
+    template <typename T>
+    bool read_record(ifstream &fin, T &record) {
+        return static_cast<bool>(fin.read(reinterpret_cast<char *>(&record), sizeof(T)));
+    }
+
+    template <typename T>
+    void append_record(string &out, const T &record) {
+        out.append(reinterpret_cast<const char *>(&record), sizeof(T));
+    }
+
+    // Smallest and largest id in list; an empty list covers no id at all
+    void store_id_range(list_info &info, const todo_list &list) {
+        info.min_id = numeric_limits<todo_id>::max();
+        info.max_id = 0;
+        for (const todo &t : list.get_todos()) {
+            info.min_id = min(info.min_id, t.get_id());
+            info.max_id = max(info.max_id, t.get_id());
+        }
+    }
+}
+
+uint64_t todo_store::open(const fs::path &dir) {
+    this->dir = dir;
+    index.clear();
+    loaded.clear();
+    due.clear();
+    resident = 0;
+
+    if (!fs::exists(dir)) {
+        fs::create_directories(dir);
+    }
+    if (!fs::exists(dir / index_file)) {
+        todo_ids().set_node(random_device {}());
+        return index_lsn = 0;
+    }
+
+    ifstream fin { dir / index_file, ios::binary };
+    index_header head {};
+    if (!fin.read(reinterpret_cast<char *>(&head), offsetof(index_header, last_id))
+        || memcmp(head.magic, index_magic, sizeof(index_magic)) != 0)
+        throw runtime_error { "todo_store: not a p2d index file" };
+    if (head.version < 1 || head.version > index_version)
+        throw runtime_error { "todo_store: unsupported index version" };
+
+    // Ids made here stay above those of shards not loaded yet, even if the
+    // clock went back since
+    if (head.version >= 3) {
+        if (!read_record(fin, head.last_id))
+            throw runtime_error { "todo_store: truncated index" };
+        todo_ids().set_node(head.node);
+        todo_ids().observe(head.last_id);
+    } else {
+        todo_ids().set_node(random_device {}());
+    }
+
+    const size_t entry_size = head.version == 1 ? offsetof(index_entry, due_count)
+        : head.version < 4                      ? offsetof(index_entry, min_id)
+                                                : sizeof(index_entry);
+    vector<index_entry> entries(head.list_count);
+    for (auto &entry : entries) {
+        if (!fin.read(reinterpret_cast<char *>(&entry), entry_size))
+            throw runtime_error { "todo_store: truncated index" };
+    }
+
+    index.reserve(entries.size());
+    for (const auto &entry : entries) {
+        list_info &info = index.emplace_back();
+        info.title.resize(entry.title_size);
+        if (!fin.read(info.title.data(), entry.title_size))
+            throw runtime_error { "todo_store: truncated index" };
+        info.shard = entry.shard;
+        info.todo_count = entry.todo_count;
+        info.next_deadline = todo::time_pt { todo::time_pt::duration { entry.next_deadline } };
+        // Unknown before version 4, so any id may be there until the shard
+        // is loaded once
+        if (head.version >= 4) {
+            info.min_id = entry.min_id;
+            info.max_id = entry.max_id;
+        }
+    }
+    next_shard = head.next_shard;
+    index_lsn = head.lsn;
+
+    if (head.version == 1) {
+        // Older indexes have no deadlines; every shard is read once for them
+        for (const auto &info : index) {
+            load(info.shard);
+            evict(info.shard);
+        }
+        return index_lsn;
+    }
+
+    for (const auto &entry : entries) {
+        for (uint32_t i = 0; i < entry.due_count; i++) {
+            due_record record;
+            if (!read_record(fin, record))
+                throw runtime_error { "todo_store: truncated index" };
+            if (head.version < 3) {
+                record.id &= numeric_limits<uint32_t>::max();
+            }
+            due.add({ todo::time_pt { todo::time_pt::duration { record.deadline } }, entry.shard, record.id });
+        }
+    }
+    return index_lsn;
+}
+
+uint64_t todo_store::import(const fs::path &file, task_pool &pool) {
+    if (!fs::exists(dir / index_file)) {
+        pmr::vector<todo_list> lists;
+        const uint64_t lsn = snapshot::load(file, lists);
+        for (todo_list &list : lists) {
+            const uint64_t id = create(list.get_title());
+            // Texts borrowed from the file's mapping are copied out here
+            loaded.at(id).list.add_range(list.extract_if([](const todo &) { return true; }));
+        }
+        refresh();
+
+        checkpoint_job job;
+        capture(lsn, job, pool, true);
+        checkpointer::run(job);
+    }
+
+    fs::remove(file);
+    return index_lsn;
+}
+
+void todo_store::apply(const journal::record &r) {
+    switch (r.type) {
+    case journal::op::create_list:
+        if (r.lsn > index_lsn && find(r.list) == end(index)) {
+            list_info &info = index.emplace_back();
+            info.title = journal::list_title(r);
+            info.shard = r.list;
+            next_shard = max(next_shard, r.list + 1);
+        }
+        break;
+
+    case journal::op::remove_list:
+        if (auto it = find(r.list); r.lsn > index_lsn && it != end(index)) {
+            remove(distance(begin(index), it));
+        }
+        break;
+
+    case journal::op::move_todos:
+        // Each side may already have been saved with the move in it
+        if (const uint64_t to = journal::move_target(r); find(to) != end(index)) {
+            if (shard &s = load(to); r.lsn > s.lsn) {
+                journal::apply_moved(r, s.list);
+            }
+        }
+        [[fallthrough]];
+
+    default:
+        if (find(r.list) != end(index)) {
+            shard &s = load(r.list);
+            if (r.lsn > s.lsn) {
+                journal::apply(r, s.list);
+            }
+        }
+        break;
+    }
+}
+
+[[nodiscard]] const vector<list_info> &todo_store::lists() const {
+    return index;
+}
+
+[[nodiscard]] size_t todo_store::size() const {
+    return index.size();
+}
+
+[[nodiscard]] const deadline_index &todo_store::deadlines() const {
+    return due;
+}
+
+[[nodiscard]] bool todo_store::contains(todo_id id) {
+    for (const list_info &info : index) {
+        if (!loaded.contains(info.shard) && (id < info.min_id || id > info.max_id))
+            continue;
+
+        const todo_list &list = load(info.shard).list;
+        if (list.find(id) != end(list.get_todos()))
+            return true;
+    }
+    return false;
+}
+
+[[nodiscard]] todo_list &todo_store::get(size_t index) {
+    return load(this->index[index].shard).list;
+}
+
+uint64_t todo_store::create(string_view title) {
+    uint64_t id = next_shard++;
+
+    list_info &info = index.emplace_back();
+    info.title = title;
+    info.shard = id;
+    info.min_id = numeric_limits<todo_id>::max();
+    info.max_id = 0;
+
+    shard &s = loaded.emplace(id, make_shard(title, 0)).first->second;
+    watch(id, s);
+    s.last_used = ++clock;
+    s.footprint = footprint(s.list);
+    resident += s.footprint;
+
+    return id;
+}
+
+uint64_t todo_store::remove(size_t index) {
+    uint64_t id = this->index[index].shard;
+    if (auto it = loaded.find(id); it != end(loaded)) {
+        resident -= it->second.footprint;
+        loaded.erase(it);
+    }
+    this->index.erase(begin(this->index) + index);
+    due.remove_list(id);
+
+    // The shard file itself goes away with the next checkpoint
+    removed.push_back(id);
+    return id;
+}
+
+void todo_store::refresh(size_t index) {
+    list_info &info = this->index[index];
+    auto it = loaded.find(info.shard);
+    if (it == end(loaded))
+        return;
+
+    // O(1) per list: the deadline index follows the list through its
+    // watcher, and the list keeps its own text size
+    shard &s = it->second;
+    info.title = s.list.get_title();
+    info.todo_count = s.list.size();
+    info.next_deadline = due.earliest(info.shard);
+
+    resident -= s.footprint;
+    s.footprint = footprint(s.list);
+    resident += s.footprint;
+}
+
+void todo_store::refresh() {
+    for (size_t i = 0; i < index.size(); i++) {
+        refresh(i);
+    }
+}
+
+void todo_store::trim(size_t keep, uint64_t settled) {
+    const uint64_t keep_id = index[keep].shard;
+
+    while (resident > budget) {
+        auto victim = end(loaded);
+        for (auto it = begin(loaded); it != end(loaded); ++it) {
+            const shard &s = it->second;
+            if (it->first == keep_id || s.in_flight > settled || s.list.is_dirty())
+                continue;
+            if (victim == end(loaded) || s.last_used < victim->second.last_used) {
+                victim = it;
+            }
+        }
+        if (victim == end(loaded))
+            break;
+
+        evict(victim->first);
+    }
+}
+
+[[nodiscard]] bool todo_store::over_budget() const {
+    return resident > budget;
+}
+
+void todo_store::set_budget(size_t bytes) {
+    budget = bytes;
+}
+
+void todo_store::capture(uint64_t lsn, checkpoint_job &job, task_pool &pool, bool everything) {
+    // Clean shards keep their older lsn; no record past it touches them
+    vector<pair<uint64_t, shard *>> changed;
+    for (auto &[id, s] : loaded) {
+        if (everything || s.list.is_dirty()) {
+            changed.emplace_back(id, &s);
+        }
+    }
+
+    // Shards only read their own list, so they encode side by side
+    const size_t first = job.files.size();
+    job.files.resize(first + changed.size());
+    pool.for_each(changed.size(), [&](size_t i) {
+        const auto [id, s] = changed[i];
+        job.files[first + i] = { shard_path(id), snapshot::encode(span { &s->list, 1 }, lsn) };
+    });
+    for (const auto &[id, s] : changed) {
+        store_id_range(*find(id), s->list);
+        s->list.mark_clean();
+        s->lsn = lsn;
+        s->in_flight = job.id;
+    }
+
+    // The index goes last: once it is in place the checkpoint is complete
+    job.files.emplace_back(dir / index_file, encode_index(lsn));
+    index_lsn = lsn;
+
+    for (uint64_t id : removed) {
+        job.obsolete.push_back(shard_path(id));
+    }
+    removed.clear();
+}
+
+todo_store::shard &todo_store::load(uint64_t id) {
+    if (auto it = loaded.find(id); it != end(loaded)) {
+        it->second.last_used = ++clock;
+        return it->second;
+    }
+
+    list_info &info = *find(id);
+    shard s = make_shard(info.title, info.todo_count);
+    if (fs::path path = shard_path(id); fs::exists(path)) {
+        pmr::vector<todo_list> lists { s.list.get_allocator() };
+        s.lsn = snapshot::load(path, lists);
+        if (lists.size() != 1)
+            throw runtime_error { "todo_store: malformed shard" };
+        s.list = std::move(lists.front());
+    }
+    // Exact from here on; capture() keeps it so for edits
+    store_id_range(info, s.list);
+    s.last_used = ++clock;
+    s.footprint = footprint(s.list);
+    resident += s.footprint;
+
+    shard &placed = loaded.emplace(id, std::move(s)).first->second;
+    // The shard file may be newer than the index it was saved with
+    watch(id, placed);
+    return placed;
+}
+
+todo_store::shard todo_store::make_shard(string_view title, size_t todo_count) {
+    // Sized so that a freshly loaded list fits in the first block
+    auto arena = make_unique<pmr::monotonic_buffer_resource>(
+        todo_count * sizeof(todo) + sizeof(todo_list) + title.size() + 256);
+    todo_list list { title, arena.get() };
+    return shard { std::move(arena), std::move(list), 0, 0, 0, 0, nullptr };
+}
+
+void todo_store::watch(uint64_t id, shard &s) {
+    s.watcher = make_unique<deadline_watcher>(due, id);
+    s.list.watch(s.watcher.get());
+    due.assign(id, s.list);
+}
+
+void todo_store::evict(uint64_t id) {
+    auto it = loaded.find(id);
+    resident -= it->second.footprint;
+    loaded.erase(it);
+}
+
+string todo_store::encode_index(uint64_t lsn) const {
+    string out;
+
+    index_header head {};
+    memcpy(head.magic, index_magic, sizeof(index_magic));
+    head.version = index_version;
+    head.lsn = lsn;
+    head.next_shard = next_shard;
+    head.list_count = index.size();
+    head.node = todo_ids().node();
+    head.last_id = todo_ids().latest();
+    append_record(out, head);
+
+    vector<vector<due_todo>> dues;
+    dues.reserve(index.size());
+    for (const auto &info : index) {
+        const auto &list_dues = dues.emplace_back(due.of_list(info.shard));
+        index_entry entry {};
+        entry.shard = info.shard;
+        entry.next_deadline = info.next_deadline.time_since_epoch().count();
+        entry.todo_count = info.todo_count;
+        entry.title_size = info.title.size();
+        entry.due_count = list_dues.size();
+        entry.min_id = info.min_id;
+        entry.max_id = info.max_id;
+        append_record(out, entry);
+    }
+    for (const auto &info : index) {
+        out += info.title;
+    }
+    for (const auto &list_dues : dues) {
+        for (const due_todo &d : list_dues) {
+            append_record(out, due_record { d.deadline.time_since_epoch().count(), d.id });
+        }
+    }
+
+    return out;
+}
+
+[[nodiscard]] vector<list_info>::iterator todo_store::find(uint64_t id) {
+    return ranges::find(index, id, &list_info::shard);
+}
+
+[[nodiscard]] fs::path todo_store::shard_path(uint64_t id) const {
+    return dir / (to_string(id) + ".bin");
+}
+
+size_t todo_store::footprint(const todo_list &list) {
+    size_t bytes = list.get_todos().capacity() * sizeof(todo);
+    bytes += list.size() * sizeof(uint32_t); // at least the current view
+    return bytes + list.text_bytes();
+}
+}
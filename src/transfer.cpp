@@ -0,0 +1,472 @@
+/**
+ *
+ * transfer.cpp
+ *
+ * Streaming import and export of todos as JSON Lines or CSV
+ *
+ * Author: Sunwoo Na
+ *
+ */
+
+#include <array>
+#include <charconv>
+#include <format>
+#include <stdexcept>
+
+#include "../include/transfer.h"
+
+using namespace std;
+
+namespace p2d {
+namespace {
+    enum column { col_list, col_id, col_title, col_description, col_created, col_deadline, col_completed, col_count };
+    constexpr array<string_view, col_count> column_names = {
+        "list", "id", "title", "description", "created", "deadline", "completed"
+    };
+
+    void append_time(string &out, const todo::time_pt &t) {
+        auto secs = chrono::floor<chrono::seconds>(t);
+        auto days = chrono::floor<chrono::days>(secs);
+        chrono::year_month_day ymd { days };
+        chrono::hh_mm_ss hms { secs - days };
+        format_to(back_inserter(out), "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}Z",
+            static_cast<int>(ymd.year()), static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()),
+            hms.hours().count(), hms.minutes().count(), hms.seconds().count());
+    }
+
+    todo::time_pt parse_time(string_view str) {
+        int y, mo, d, h, mi, s;
+        auto number = [&](size_t pos, size_t len, int &value) {
+            return pos + len <= str.size()
+                && from_chars(str.data() + pos, str.data() + pos + len, value).ptr == str.data() + pos + len;
+        };
+        if (str.size() < 19 || !number(0, 4, y) || str[4] != '-' || !number(5, 2, mo) || str[7] != '-'
+            || !number(8, 2, d) || (str[10] != 'T' && str[10] != ' ') || !number(11, 2, h) || str[13] != ':'
+            || !number(14, 2, mi) || str[16] != ':' || !number(17, 2, s))
+            throw runtime_error { format("invalid time \"{}\"", str) };
+
+        chrono::year_month_day ymd { chrono::year { y }, chrono::month(mo), chrono::day(d) };
+        if (!ymd.ok() || h > 23 || mi > 59 || s > 60)
+            throw runtime_error { format("invalid time \"{}\"", str) };
+        return chrono::sys_days { ymd } + chrono::hours { h } + chrono::minutes { mi } + chrono::seconds { s };
+    }
+
+    bool parse_bool(string_view str) {
+        if (str == "true" || str == "1")
+            return true;
+        if (str == "false" || str == "0" || str.empty())
+            return false;
+        throw runtime_error { format("invalid boolean \"{}\"", str) };
+    }
+
+    todo_id parse_id(string_view str) {
+        todo_id value = 0;
+        if (auto [ptr, ec] = from_chars(str.data(), str.data() + str.size(), value);
+            ec != errc {} || ptr != str.data() + str.size())
+            throw runtime_error { format("invalid id \"{}\"", str) };
+        return value;
+    }
+
+    void append_json(string &out, string_view str) {
+        out += '"';
+        for (char c : str) {
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    format_to(back_inserter(out), "\\u{:04x}", static_cast<int>(c));
+                else
+                    out += c;
+            }
+        }
+        out += '"';
+    }
+
+    void append_csv(string &out, string_view str) {
+        if (str.find_first_of(",\"\r\n") == string_view::npos) {
+            out += str;
+            return;
+        }
+        out += '"';
+        for (char c : str) {
+            if (c == '"')
+                out += '"';
+            out += c;
+        }
+        out += '"';
+    }
+
+    void append_utf8(string &out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // Just enough JSON for one flat object per line
+    class json_cursor {
+    public:
+        json_cursor(string_view text)
+            : text { text } { }
+
+        void skip_space() {
+            while (pos < text.size() && is_space(text[pos]))
+                pos++;
+        }
+
+        bool consume(char c) {
+            skip_space();
+            if (pos < text.size() && text[pos] == c) {
+                pos++;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char c) {
+            if (!consume(c))
+                throw runtime_error { format("expected '{}' at column {}", c, pos + 1) };
+        }
+
+        [[nodiscard]] bool at_end() {
+            skip_space();
+            return pos == text.size();
+        }
+
+        [[nodiscard]] bool peek_string() {
+            skip_space();
+            return pos < text.size() && text[pos] == '"';
+        }
+
+        void string_value(string &out) {
+            out.clear();
+            expect('"');
+            while (true) {
+                if (pos >= text.size())
+                    throw runtime_error { "unterminated string" };
+                char c = text[pos++];
+                if (c == '"')
+                    return;
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pos >= text.size())
+                    throw runtime_error { "unterminated string" };
+                switch (char e = text[pos++]) {
+                case '"': case '\\': case '/': out += e; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t cp = hex4();
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        // Only a low surrogate completes the pair; any other
+                        // escape after it is read on its own
+                        const size_t mark = pos;
+                        uint32_t low = 0;
+                        if (text.substr(pos, 2) == "\\u") {
+                            pos += 2;
+                            low = hex4();
+                        }
+                        if (low >= 0xDC00 && low < 0xE000) {
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        } else {
+                            pos = mark;
+                            cp = replacement;
+                        }
+                    } else if (cp >= 0xDC00 && cp < 0xE000) {
+                        cp = replacement; // a low surrogate on its own
+                    }
+                    append_utf8(out, cp);
+                    break;
+                }
+                default:
+                    throw runtime_error { format("invalid escape '\\{}'", e) };
+                }
+            }
+        }
+
+        // A number, true, false or null, returned as written
+        string_view scalar() {
+            skip_space();
+            size_t start = pos;
+            while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && !is_space(text[pos]))
+                pos++;
+            if (start == pos)
+                throw runtime_error { format("expected a value at column {}", pos + 1) };
+            return text.substr(start, pos - start);
+        }
+
+    private:
+        string_view text;
+        size_t pos = 0;
+
+        // Unpaired surrogates have no UTF-8 encoding and become U+FFFD
+        static constexpr uint32_t replacement = 0xFFFD;
+
+        static bool is_space(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        uint32_t hex4() {
+            uint32_t value = 0;
+            if (pos + 4 > text.size() || from_chars(text.data() + pos, text.data() + pos + 4, value, 16).ptr != text.data() + pos + 4)
+                throw runtime_error { "invalid \\u escape" };
+            pos += 4;
+            return value;
+        }
+    };
+}
+
+[[nodiscard]] optional<transfer_format> transfer_format_of(string_view name) {
+    auto ends_with = [&](string_view ext) {
+        return name == ext || name.ends_with(string { "." } + string { ext });
+    };
+    if (ends_with("jsonl") || ends_with("json"))
+        return transfer_format::jsonl;
+    if (ends_with("csv"))
+        return transfer_format::csv;
+    return nullopt;
+}
+
+[[nodiscard]] double transfer_stats::per_second() const {
+    return elapsed.count() > 0 ? records * 1e6 / elapsed.count() : 0.0;
+}
+
+///////// WRITER //////////
+todo_writer::todo_writer(ostream &out, transfer_format format)
+    : out { out }
+    , file_format { format } {
+    if (file_format == transfer_format::csv) {
+        out << "list,id,title,description,created,deadline,completed\n";
+    }
+}
+
+void todo_writer::write(string_view list, const todo &t) {
+    line.clear();
+    const bool has_deadline = t.get_deadline() != todo::time_pt::max();
+
+    if (file_format == transfer_format::jsonl) {
+        line += "{\"list\":";
+        append_json(line, list);
+        format_to(back_inserter(line), ",\"id\":{},\"title\":", t.get_id());
+        append_json(line, t.get_title());
+        line += ",\"description\":";
+        append_json(line, t.get_description());
+        line += ",\"created\":\"";
+        append_time(line, t.get_created());
+        line += "\",\"deadline\":";
+        if (has_deadline) {
+            line += '"';
+            append_time(line, t.get_deadline());
+            line += '"';
+        } else {
+            line += "null";
+        }
+        line += t.is_completed() ? ",\"completed\":true}\n" : ",\"completed\":false}\n";
+    } else {
+        append_csv(line, list);
+        format_to(back_inserter(line), ",{},", t.get_id());
+        append_csv(line, t.get_title());
+        line += ',';
+        append_csv(line, t.get_description());
+        line += ',';
+        append_time(line, t.get_created());
+        line += ',';
+        if (has_deadline) {
+            append_time(line, t.get_deadline());
+        }
+        line += t.is_completed() ? ",true\n" : ",false\n";
+    }
+
+    out.write(line.data(), line.size());
+    written++;
+}
+
+[[nodiscard]] uint64_t todo_writer::count() const {
+    return written;
+}
+
+///////// READER //////////
+todo_reader::todo_reader(istream &in, transfer_format format)
+    : in { in }
+    , file_format { format } { }
+
+bool todo_reader::next(todo_row &row) {
+    try {
+        return file_format == transfer_format::jsonl ? next_json(row) : next_csv(row);
+    } catch (const runtime_error &e) {
+        throw runtime_error { format("line {}: {}", line_number, e.what()) };
+    }
+}
+
+[[nodiscard]] uint64_t todo_reader::line() const {
+    return line_number;
+}
+
+bool todo_reader::next_json(todo_row &row) {
+    do {
+        if (!getline(in, buffer))
+            return false;
+        line_number++;
+    } while (buffer.find_first_not_of(" \t\r") == string::npos);
+
+    row.list.clear();
+    row.title.clear();
+    row.description.clear();
+    row.id = 0;
+    row.created = chrono::system_clock::now();
+    row.deadline = todo::time_pt::max();
+    row.completed = false;
+
+    json_cursor cur { buffer };
+    string key, value;
+    bool has_list = false, has_title = false;
+
+    cur.expect('{');
+    if (!cur.consume('}')) {
+        do {
+            cur.string_value(key);
+            cur.expect(':');
+
+            if (key == "list") {
+                cur.string_value(row.list);
+                has_list = true;
+            } else if (key == "title") {
+                cur.string_value(row.title);
+                has_title = true;
+            } else if (key == "description") {
+                cur.string_value(row.description);
+            } else if (key == "id") {
+                row.id = parse_id(cur.scalar());
+            } else if (key == "completed") {
+                row.completed = parse_bool(cur.scalar());
+            } else if (key == "created" || key == "deadline") {
+                auto &target = key == "created" ? row.created : row.deadline;
+                if (cur.peek_string()) {
+                    cur.string_value(value);
+                    target = parse_time(value);
+                } else if (cur.scalar() != "null") {
+                    throw runtime_error { format("\"{}\" must be a string or null", key) };
+                }
+            } else if (cur.peek_string()) {
+                cur.string_value(value); // unknown field
+            } else {
+                (void)cur.scalar();
+            }
+        } while (cur.consume(','));
+        cur.expect('}');
+    }
+    if (!cur.at_end())
+        throw runtime_error { "trailing characters after the object" };
+    if (!has_list || !has_title)
+        throw runtime_error { "\"list\" and \"title\" are required" };
+    return true;
+}
+
+bool todo_reader::next_csv(todo_row &row) {
+    if (columns.empty()) {
+        if (!read_csv_record())
+            return false;
+
+        columns.assign(col_count, -1);
+        for (size_t i = 0; i < field_count; i++) {
+            for (size_t c = 0; c < col_count; c++) {
+                if (fields[i] == column_names[c])
+                    columns[c] = i;
+            }
+        }
+        if (columns[col_list] < 0 || columns[col_title] < 0)
+            throw runtime_error { "the header needs \"list\" and \"title\" columns" };
+    }
+
+    do {
+        if (!read_csv_record())
+            return false;
+    } while (field_count == 1 && fields[0].empty()); // blank line
+
+    auto field = [&](column c) -> string_view {
+        int i = columns[c];
+        return i >= 0 && static_cast<size_t>(i) < field_count ? string_view { fields[i] } : string_view {};
+    };
+
+    row.list = field(col_list);
+    row.title = field(col_title);
+    row.description = field(col_description);
+    row.id = field(col_id).empty() ? 0 : parse_id(field(col_id));
+    row.created = field(col_created).empty() ? chrono::system_clock::now() : parse_time(field(col_created));
+    row.deadline = field(col_deadline).empty() ? todo::time_pt::max() : parse_time(field(col_deadline));
+    row.completed = parse_bool(field(col_completed));
+    return true;
+}
+
+bool todo_reader::read_csv_record() {
+    using traits = istream::traits_type;
+    streambuf *buf = in.rdbuf();
+    if (traits::eq_int_type(buf->sgetc(), traits::eof()))
+        return false;
+    line_number++;
+
+    auto next_field = [this]() -> string & {
+        if (field_count == fields.size())
+            fields.emplace_back();
+        fields[field_count].clear();
+        return fields[field_count++];
+    };
+
+    field_count = 0;
+    string *field = &next_field();
+    bool quoted = false;
+    while (true) {
+        auto c = buf->sbumpc();
+        if (traits::eq_int_type(c, traits::eof())) {
+            if (quoted)
+                throw runtime_error { "unterminated quoted field" };
+            return true;
+        }
+
+        char ch = traits::to_char_type(c);
+        if (quoted) {
+            if (ch != '"') {
+                line_number += ch == '\n';
+                *field += ch;
+            } else if (traits::eq_int_type(buf->sgetc(), '"')) {
+                buf->sbumpc();
+                *field += '"';
+            } else {
+                quoted = false;
+            }
+        } else if (ch == '"') {
+            quoted = true;
+        } else if (ch == ',') {
+            field = &next_field();
+        } else if (ch == '\n') {
+            return true;
+        } else if (ch == '\r') {
+            if (traits::eq_int_type(buf->sgetc(), '\n'))
+                buf->sbumpc();
+            return true;
+        } else {
+            *field += ch;
+        }
+    }
+}
+}
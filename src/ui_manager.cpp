@@ -9,6 +9,7 @@
  *
  */
 
+#include <charconv>
 #include <chrono>
 #include <format>
 #include <fstream>
@@ -33,7 +34,27 @@ int ui_manager::memo_selected_index() const
     return memo_selected;
 }
 
-pair<string, int> ui_manager::show_all_lists(const std::vector<todo_list>& todoLists)
+const std::vector<todo_id>& ui_manager::marked() const
+{
+    return marked_ids;
+}
+
+const std::string& ui_manager::move_target() const
+{
+    return move_title;
+}
+
+void ui_manager::clear_marks()
+{
+    marked_ids.clear();
+}
+
+int ui_manager::agenda_selected_index() const
+{
+    return agenda_selected;
+}
+
+pair<string, int> ui_manager::show_all_lists(const std::vector<list_info>& todoLists)
 {
 
     clear();
@@ -44,11 +65,11 @@ pair<string, int> ui_manager::show_all_lists(const std::vector<todo_list>& todoL
     int i = 1;
 
     for (const auto& list : todoLists) {
-        cout << format("{}. {}", i++, list.get_title()) << '\n';
+        cout << format("{}. {} ({})", i++, list.title, list.todo_count) << '\n';
     }
 
     cout << "====================\n";
-    cout << "Type command (add/remove/select/exit): ";
+    cout << "Type command (add/remove/select/agenda/exit): ";
 
     std::string command;
     cin >> command;
@@ -57,6 +78,8 @@ pair<string, int> ui_manager::show_all_lists(const std::vector<todo_list>& todoL
         return { command, -1 };
     } else if (command == "exit") {
         return { command, 0 };
+    } else if (command == "agenda") {
+        return { command, 1 };
     }
 
     cin >> list_selected;
@@ -74,10 +97,10 @@ pair<string, int> ui_manager::list_memos(const todo_list& todoList)
     clear();
 
     cout << format("<{}>\n", todoList.get_title());
-    cout << format("{} memos\n", todoList.get_todos().size());
+    cout << format("{} memos, by {}\n", todoList.size(), order_name(todoList.get_order()));
 
     int i = 1;
-    for (const auto& memo : todoList.get_todos()) {
+    for (const auto& memo : todoList.view()) {
         cout << format("{}: {} {} (Deadline: {:})",
             i++,
             (memo.is_completed() ? "[X]" : "[ ]"),
@@ -87,7 +110,7 @@ pair<string, int> ui_manager::list_memos(const todo_list& todoList)
     }
 
     cout << "====================\n";
-    cout << "Type command (add/remove/edit/exit/check/uncheck): ";
+    cout << "Type command (add/remove/edit/exit/check/uncheck/sort/clear): ";
 
     std::string command;
     cin >> command;
@@ -97,6 +120,8 @@ pair<string, int> ui_manager::list_memos(const todo_list& todoList)
         return { command, -1 };
     } else if (command == "exit") {
         return { command, 0 };
+    } else if (command == "sort" || command == "clear") {
+        return { command, memo_selected + 1 };
     }
 
     cin >> memo_selected;
@@ -112,7 +137,45 @@ pair<string, int> ui_manager::list_memos(const todo_list& todoList)
     return { "uncheck", memo_selected + 1 };
 }
 
-void ui_manager::create_list(std::vector<todo_list>& todoLists)
+pair<string, int> ui_manager::show_agenda(agenda& rows, const std::vector<list_info>& todoLists)
+{
+    clear();
+
+    cout << "<Agenda>\n";
+    cout << format("{} open memos with a deadline in {} lists\n", rows.size(), todoLists.size());
+
+    for (size_t i = 0; i < rows.size(); i++) {
+        const auto& row = rows[i];
+        if (!row.found) {
+            cout << format("{}: (no longer there)\n", i + 1);
+            continue;
+        }
+        cout << format("{}: [ ] {} <{}> (Deadline: {:})",
+            i + 1,
+            row.title,
+            todoLists[row.list].title,
+            row.deadline)
+             << '\n';
+    }
+
+    cout << "====================\n";
+    cout << "Type command (exit/check): ";
+
+    std::string command;
+    cin >> command;
+    cin.get();
+
+    if (command != "check") {
+        return { "exit", 0 };
+    }
+
+    cin >> agenda_selected;
+    cin.get();
+    agenda_selected--;
+    return { "check", agenda_selected + 1 };
+}
+
+string ui_manager::create_list()
 {
     clear();
 
@@ -120,10 +183,10 @@ void ui_manager::create_list(std::vector<todo_list>& todoLists)
     string title;
     getline(cin, title);
 
-    todoLists.push_back(todo_list { title });
+    return title;
 }
 
-void ui_manager::create_memo(todo_list& todoList)
+int ui_manager::create_memo(todo_list& todoList)
 {
     clear();
 
@@ -147,9 +210,11 @@ void ui_manager::create_memo(todo_list& todoList)
     // Convert std::time_t to std::chrono::time_point
     auto deadline = chrono::system_clock::from_time_t(time);
 
-    int id = todoList.add(title, "", deadline);
+    int pos = todoList.add(title, "", deadline);
 
-    interact_memo(todoList.get_todos()[id]);
+    return todoList.update(pos, [this](todo &memo) {
+        interact_memo(memo);
+    });
 }
 
 void ui_manager::interact_memo(todo& memo)
@@ -158,7 +223,7 @@ void ui_manager::interact_memo(todo& memo)
     const bool has_nano = system("nano --version > /dev/null 2>&1") == 0;
 
     // 1. save memo to file
-    string memo_file = memo.get_title();
+    string memo_file { memo.get_title() };
     ofstream fout { memo_file };
     fout << memo.get_description();
     fout.close();
@@ -194,7 +259,7 @@ void ui_manager::interact_memo(todo& memo)
     memo.set_description(description);
 }
 
-void ui_manager::login(std::unique_ptr<user>& current_user, user_list& all_users)
+void ui_manager::login(std::unique_ptr<user>& current_user, user_list& all_users, const authenticator& auth)
 {
     clear();
     cout << format("Welcome to {}!\n", session::app_name);
@@ -202,18 +267,45 @@ void ui_manager::login(std::unique_ptr<user>& current_user, user_list& all_users
     cout << "====================\n";
 
     string id;
+    char* pass;
     while (true) {
-        cout << "ID: ";
+        cout << "ID (or \"new\" to register): ";
         cin >> id;
         cin.get();
-
-        if (!all_users.contains(id))
+        if (id == "new")
             break;
 
-        cout << "ID already exists. Please try again.\n";
+        pass = getpass("Password: ");
+        if (!pass) {
+            cout << "Password input error.\n";
+            return;
+        }
+
+        // Unknown ids, and users saved before passwords were kept, fail
+        // like a wrong password and after as long, so a failed login does
+        // not tell whether the id exists
+        if (!auth.verify(id, pass)) {
+            cout << "Invalid ID or password. Please try again.\n";
+            continue;
+        }
+
+        if (auth.needs_rehash(all_users[id]))
+            all_users.set_password(id, auth.hash(pass));
+        current_user = make_unique<user>(all_users[id]);
+        return;
+    }
+
+    // Registering is asked for by name, never fallen into by a typo
+    while (true) {
+        cout << "New ID: ";
+        cin >> id;
+        cin.get();
+        if (id != "new" && !all_users.contains(id))
+            break;
+        cout << "ID already taken. Please choose another.\n";
     }
 
-    char* pass = getpass("Password: ");
+    pass = getpass("Password: ");
     if (!pass) {
         cout << "Password input error.\n";
         return;
@@ -227,7 +319,7 @@ void ui_manager::login(std::unique_ptr<user>& current_user, user_list& all_users
     string email;
     cin >> email;
 
-    all_users.add(user { name, email, id, password { pass } });
+    all_users.add(user { name, email, id, auth.hash(pass) });
     current_user = make_unique<user>(all_users[id]);
 }
 
@@ -286,11 +378,9 @@ ui_manager_ncurses::~ui_manager_ncurses()
 }
 
 std::pair<std::string, int>
-ui_manager_ncurses::show_all_lists(const std::vector<todo_list>& todoLists)
+ui_manager_ncurses::show_all_lists(const std::vector<list_info>& todoLists)
 {
-    wclear(header);
-    wclear(list);
-    wclear(bottom);
+    begin_view();
 
     // Header: Todo List 개수, 유저 이름
     int max_x = getmaxx(header);
@@ -306,35 +396,21 @@ ui_manager_ncurses::show_all_lists(const std::vector<todo_list>& todoLists)
 
     // Bottom: 사용법
     max_x = getmaxx(bottom);
-    std::string_view usage = "Esc: Exit    Enter: Select    a: Add    Del: Remove";
+    std::string_view usage = "Esc: Exit    Enter: Select    a: Add    Del: Remove    g: Agenda    PgUp/PgDn/Home/End: Scroll";
     start_x = (max_x - usage.length()) / 2;
     mvwprintw(bottom, 0, start_x, "%s", usage.data());
     wrefresh(bottom);
 
     list_offset = 0; // 첫 번째 리스트부터 출력
+    keep_visible(todoLists.size(), list_selected, list_offset);
 
     do {
-        wclear(list);
-        int y = 1;
-        auto start = begin(todoLists) + list_offset;
-        auto end = start + std::min<size_t>(todoLists.size(), getmaxy(list) - 1);
-        for (auto& l : ranges::subrange(start, end)) {
-            if (y - 1 == list_selected) {
-                wattron(list, COLOR_PAIR(2));
-            }
-
-            // TODO:... x max까지 채워야 함.
-            std::string title = format("{}: {}", list_offset + y, l.get_title());
-            mvwprintw(list, y, 0, "%-*s", getmaxx(list), title.data()); // 제목 출력 및 나머지 공간을 공백으로 채움
-
-            if (y - 1 == list_selected) {
-                wattroff(list, COLOR_PAIR(2));
-            }
-
-            y++;
-        }
-
-        wrefresh(list);
+        draw_rows(list_offset, todoLists.size() - list_offset,
+            [this](int pos) { return row_key { pos, pos == list_selected }; },
+            [&](int pos) {
+                const list_info& l = todoLists[pos];
+                return format("{}: {} ({})", pos + 1, l.title, l.todo_count);
+            });
 
         switch (int ch = wgetch(list); ch) {
         case 'a': // 'a' pressed, add
@@ -347,24 +423,14 @@ ui_manager_ncurses::show_all_lists(const std::vector<todo_list>& todoLists)
         case 10: // Enter pressed, select
             return { "select", list_selected + 1 };
 
-        case KEY_UP:
-            list_selected = std::max(0, list_selected - 1);
-            if (list_selected < list_offset) {
-                list_offset = std::max(0, list_offset - 1);
-            }
-            break;
-
-        case KEY_DOWN:
-            list_selected = std::min<int>(todoLists.size() - 1, list_selected + 1);
-            if (list_selected >= list_offset + getmaxy(list) - 1) {
-                list_offset = std::min<int>(todoLists.size() - getmaxy(list) + 1, list_offset + 1);
-            }
-            break;
+        case 'g': // 'g' pressed, agenda of all lists
+            return { "agenda", 1 };
 
         [[unlikely]] case 27: // ESC
             return { "exit", 0 };
 
         default:
+            move_selection(ch, todoLists.size(), list_selected, list_offset);
             break;
         }
     } while (true);
@@ -373,52 +439,53 @@ ui_manager_ncurses::show_all_lists(const std::vector<todo_list>& todoLists)
 std::pair<std::string, int>
 ui_manager_ncurses::list_memos(const todo_list& todoList)
 {
-    wclear(header);
-    wclear(list);
-    wclear(bottom);
+    begin_view();
 
     // Header: Todo List 개수, 유저 이름
     int max_x = getmaxx(header);
     std::string title1 = format("Viewing list: {}\n", todoList.get_title());
-    std::string_view title2 = format("{} todos\n", todoList.get_todos().size());
     int start_x = (max_x - title1.length()) / 2;
     mvwprintw(header, 0, start_x, "%s", title1.data());
-    start_x = (max_x - title2.length()) / 2;
-    mvwprintw(header, 1, start_x, "%s", title2.data());
-    wrefresh(header);
 
     // Bottom: 사용법
     max_x = getmaxx(bottom);
-    std::string_view usage = "Esc: Exit    Enter: Select    a: Add    e: Edit    Del: Remove    Space: Check/Uncheck";
+    std::string_view usage = "Esc: Exit    Enter: Select    a: Add    e: Edit    Del: Remove    Space: Check/Uncheck    s: Sort    /: Search    n: Next    "
+                             "v: Mark    m: Move marked    C: Clear completed    PgUp/PgDn/Home/End: Scroll    :: Go to";
     start_x = (max_x - usage.length()) / 2;
     mvwprintw(bottom, 0, start_x, "%s", usage.data());
     wrefresh(bottom);
 
     memo_offset = 0; // 첫 번째 리스트부터 출력
 
-    auto& todos = todoList.get_todos();
+    // Todos may have been removed since the last call
+    auto todos = todoList.view();
+    keep_visible(todos.size(), memo_selected, memo_offset);
+    auto is_marked = [this](const todo& memo) {
+        return std::ranges::find(marked_ids, memo.get_id()) != marked_ids.end();
+    };
+    size_t header_marks = -1; // marks counted in the header as drawn
     do {
-        wclear(list);
-        int y = 1;
-        auto start = begin(todos) + memo_offset;
-        auto end = start + std::min<size_t>(todos.size(), getmaxy(list) - 1);
-        for (auto& l : ranges::subrange(start, end)) {
-            if (y - 1 == memo_selected) {
-                wattron(list, COLOR_PAIR(2));
-            }
-
-            std::string title = format("[{}] {}: {}",
-                (l.is_completed() ? "X" : " "), memo_offset + y, l.get_title());
-            mvwprintw(list, y, 0, "%-*s", getmaxx(list), title.data()); // 제목 출력 및 나머지 공간을 공백으로 채움
-
-            if (y - 1 == memo_selected) {
-                wattroff(list, COLOR_PAIR(2));
-            }
-
-            y++;
+        // Marking changes the second line of the header
+        if (header_marks != marked_ids.size()) {
+            header_marks = marked_ids.size();
+            std::string title2 = marked_ids.empty()
+                ? format("{} todos, by {}\n", todoList.size(), order_name(todoList.get_order()))
+                : format("{} todos, by {}, {} marked\n", todoList.size(), order_name(todoList.get_order()), marked_ids.size());
+            wmove(header, 1, 0);
+            wclrtoeol(header);
+            mvwprintw(header, 1, (getmaxx(header) - title2.length()) / 2, "%s", title2.data());
+            wrefresh(header);
         }
 
-        wrefresh(list);
+        draw_rows(memo_offset, todos.size() - memo_offset,
+            [&](int pos) { return row_key { pos, pos == memo_selected, is_marked(todos[pos]) }; },
+            [&](int pos) {
+                std::string row = memo_row(todoList, pos);
+                if (is_marked(todos[pos])) {
+                    row[3] = '*';
+                }
+                return row;
+            });
 
         switch (int ch = wgetch(list); ch) {
         case 'a': // 'a' pressed, add
@@ -426,27 +493,24 @@ ui_manager_ncurses::list_memos(const todo_list& todoList)
 
         case KEY_DC: // Del pressed, remove
         case 127:
+            if (!marked_ids.empty()) {
+                return { "remove_marked", memo_selected + 1 };
+            }
             return { "remove", memo_selected + 1 };
 
         case 10: // Enter pressed, select
             return { "select", memo_selected + 1 };
 
-        case KEY_UP:
-            memo_selected = std::max(0, memo_selected - 1);
-            if (memo_selected < memo_offset) {
-                memo_offset = std::max(0, memo_offset - 1);
-            }
-            break;
-
-        case KEY_DOWN:
-            memo_selected = std::min<int>(todos.size() - 1, memo_selected + 1);
-            if (memo_selected >= memo_offset + getmaxy(list) - 1) {
-                memo_offset = std::min<int>(todos.size() - getmaxy(list) + 1, memo_offset + 1);
-            }
-            break;
-
         // Space
         case ' ':
+            if (!marked_ids.empty()) {
+                // Checks them all unless all are checked already
+                const bool all_checked = std::ranges::all_of(todos | std::views::filter(is_marked), &todo::is_completed);
+                return { all_checked ? "uncheck_marked" : "check_marked", memo_selected + 1 };
+            }
+            if (todos.empty()) {
+                break;
+            }
             if (todos[memo_selected].is_completed()) {
                 return { "uncheck", memo_selected + 1 };
             } else {
@@ -456,16 +520,158 @@ ui_manager_ncurses::list_memos(const todo_list& todoList)
         case 'e': // 'e' pressed, edit
             return { "edit", memo_selected + 1 };
 
+        case 'v': // 'v' pressed, mark or unmark
+            if (todos.empty()) {
+                break;
+            }
+            if (auto it = std::ranges::find(marked_ids, todos[memo_selected].get_id()); it != marked_ids.end()) {
+                marked_ids.erase(it);
+            } else {
+                marked_ids.push_back(todos[memo_selected].get_id());
+            }
+            // Move on, so that a run of todos is marked key by key
+            memo_selected++;
+            keep_visible(todos.size(), memo_selected, memo_offset);
+            break;
+
+        case ':': // ':' pressed, go to a position
+            jump(todos.size(), memo_selected, memo_offset);
+            break;
+
+        case 'm': // 'm' pressed, move the marked todos to another list
+            if (marked_ids.empty()) {
+                break;
+            }
+            werase(bottom);
+            mvwprintw(bottom, 0, 0, "Move %zu todos to list: ", marked_ids.size());
+            wrefresh(bottom);
+            move_title.clear();
+            readline(bottom, move_title);
+            return { "move_marked", memo_selected + 1 };
+
+        case 'C': // 'C' pressed, remove every completed todo
+            return { "clear", memo_selected + 1 };
+
+        case 's': // 's' pressed, cycle the sort order
+            return { "sort", memo_selected + 1 };
+
+        case '/': // '/' pressed, search
+            werase(bottom);
+            mvwprintw(bottom, 0, 0, "/");
+            wrefresh(bottom);
+            search_query.clear();
+            readline(bottom, search_query);
+            memo_selected = -1; // start from the top
+            next_match(todoList);
+            break;
+
+        case 'n': // 'n' pressed, next match
+            next_match(todoList);
+            break;
+
+        [[unlikely]] case 27: // ESC
+            marked_ids.clear();
+            return { "exit", 0 };
+
+        default:
+            move_selection(ch, todos.size(), memo_selected, memo_offset);
+            break;
+        }
+    } while (true);
+}
+
+std::pair<std::string, int>
+ui_manager_ncurses::show_agenda(agenda& rows, const std::vector<list_info>& todoLists)
+{
+    begin_view();
+
+    int max_x = getmaxx(header);
+    std::string title1 = "Agenda";
+    std::string title2 = format("{} open todos with a deadline in {} lists", rows.size(), todoLists.size());
+    int start_x = (max_x - title1.length()) / 2;
+    mvwprintw(header, 0, start_x, "%s", title1.data());
+    start_x = (max_x - title2.length()) / 2;
+    mvwprintw(header, 1, start_x, "%s", title2.data());
+    wrefresh(header);
+
+    max_x = getmaxx(bottom);
+    std::string_view usage = "Esc: Exit    Space: Check    PgUp/PgDn/Home/End: Scroll    :: Go to";
+    start_x = (max_x - usage.length()) / 2;
+    mvwprintw(bottom, 0, start_x, "%s", usage.data());
+    wrefresh(bottom);
+
+    // The agenda is rebuilt after every change, so the place is kept
+    const int count = rows.size();
+    keep_visible(count, agenda_selected, agenda_offset);
+
+    do {
+        // Only the rows on screen are merged, and only their lists loaded
+        draw_rows(agenda_offset, count - agenda_offset,
+            [this](int pos) { return row_key { pos, pos == agenda_selected }; },
+            [&](int pos) {
+                const agenda_row& row = rows[pos];
+                if (!row.found) {
+                    return format("[?] {}: (no longer there)", pos + 1);
+                }
+                return format("[ ] {}: {}  <{}>", pos + 1, row.title, todoLists[row.list].title);
+            });
+
+        switch (int ch = wgetch(list); ch) {
+        case ':': // ':' pressed, go to a position
+            jump(count, agenda_selected, agenda_offset);
+            break;
+
+        // Space
+        case ' ':
+            if (count == 0 || !rows[agenda_selected].found) {
+                break;
+            }
+            return { "check", agenda_selected + 1 };
+
         [[unlikely]] case 27: // ESC
             return { "exit", 0 };
 
         default:
+            move_selection(ch, count, agenda_selected, agenda_offset);
             break;
         }
     } while (true);
 }
 
-void ui_manager_ncurses::create_list(std::vector<todo_list>& todoLists)
+void ui_manager_ncurses::next_match(const todo_list& todoList)
+{
+    werase(bottom);
+    if (search_query.empty()) {
+        memo_selected = std::max(memo_selected, 0);
+        mvwprintw(bottom, 0, 0, "No search yet, press / to search");
+        wrefresh(bottom);
+        return;
+    }
+
+    // Matches come in the order shown, so the next one is found by position
+    const std::vector<todo_id> matches = todoList.search(search_query);
+    auto position = [&todoList](todo_id id) { return static_cast<int>(todoList.position(id)); };
+    auto next = ranges::upper_bound(matches, memo_selected, {}, position);
+    if (next == matches.end()) {
+        next = matches.begin(); // wrap around
+    }
+
+    if (matches.empty()) {
+        memo_selected = std::max(memo_selected, 0);
+        mvwprintw(bottom, 0, 0, "No match for \"%s\"", search_query.data());
+    } else {
+        memo_selected = position(*next);
+        const int rows = getmaxy(list) - 1;
+        if (memo_selected < memo_offset || memo_selected >= memo_offset + rows) {
+            memo_offset = std::max(0, memo_selected - rows / 2);
+        }
+        mvwprintw(bottom, 0, 0, "Match %d of %zu for \"%s\"",
+            static_cast<int>(next - matches.begin()) + 1, matches.size(), search_query.data());
+    }
+    wrefresh(bottom);
+}
+
+std::string ui_manager_ncurses::create_list()
 {
     clear();
 
@@ -479,10 +685,10 @@ void ui_manager_ncurses::create_list(std::vector<todo_list>& todoLists)
     std::string title;
     readline(list, title);
 
-    todoLists.push_back(todo_list { title });
+    return title;
 }
 
-void ui_manager_ncurses::create_memo(todo_list& todoList)
+int ui_manager_ncurses::create_memo(todo_list& todoList)
 {
     clear();
 
@@ -513,9 +719,11 @@ void ui_manager_ncurses::create_memo(todo_list& todoList)
     // Convert std::time_t to std::chrono::time_point
     auto deadline = chrono::system_clock::from_time_t(time);
 
-    int id = todoList.add(title, "", deadline);
+    int pos = todoList.add(title, "", deadline);
 
-    interact_memo(todoList.get_todos()[id]);
+    return todoList.update(pos, [this](todo &memo) {
+        interact_memo(memo);
+    });
 }
 
 void ui_manager_ncurses::interact_memo(todo& memo)
@@ -524,7 +732,7 @@ void ui_manager_ncurses::interact_memo(todo& memo)
     const bool has_nano = system("nano --version > /dev/null 2>&1") == 0;
 
     // 1. save memo to file
-    string memo_file = memo.get_title();
+    string memo_file { memo.get_title() };
     ofstream fout { memo_file };
     fout << memo.get_description();
     fout.close();
@@ -566,9 +774,97 @@ void ui_manager_ncurses::interact_memo(todo& memo)
     memo.set_description(description);
 }
 
-void ui_manager_ncurses::login(std::unique_ptr<user>& current_user, user_list& all_users)
+void ui_manager_ncurses::login(std::unique_ptr<user>& current_user, user_list& all_users, const authenticator& auth)
+{
+    ui_manager::login(current_user, all_users, auth);
+}
+
+bool ui_manager_ncurses::move_selection(int ch, int count, int& selected, int& offset)
+{
+    const int rows = getmaxy(list) - 1;
+    switch (ch) {
+    case KEY_UP:
+        selected--;
+        break;
+
+    case KEY_DOWN:
+        selected++;
+        break;
+
+    case KEY_PPAGE: // the page above, keeping the selection's row
+        selected -= rows;
+        offset -= rows;
+        break;
+
+    case KEY_NPAGE:
+        selected += rows;
+        offset += rows;
+        break;
+
+    case KEY_HOME:
+        selected = 0;
+        break;
+
+    case KEY_END:
+        selected = count - 1;
+        break;
+
+    default:
+        return false;
+    }
+
+    keep_visible(count, selected, offset);
+    return true;
+}
+
+void ui_manager_ncurses::jump(int count, int& selected, int& offset)
+{
+    werase(bottom);
+    mvwprintw(bottom, 0, 0, "Go to (1-%d): ", count);
+    wrefresh(bottom);
+
+    std::string input;
+    readline(bottom, input);
+    int pos = 0;
+    if (auto [end, ec] = std::from_chars(input.data(), input.data() + input.size(), pos); ec != std::errc {} || pos < 1) {
+        return;
+    }
+
+    selected = pos - 1;
+    // Centered, like a search match
+    offset = selected - (getmaxy(list) - 1) / 2;
+    keep_visible(count, selected, offset);
+}
+
+void ui_manager_ncurses::keep_visible(int count, int& selected, int& offset)
+{
+    const int rows = getmaxy(list) - 1;
+    selected = std::clamp(selected, 0, std::max(count - 1, 0));
+    offset = std::clamp(offset, 0, std::max(count - rows, 0));
+    offset = std::clamp(offset, selected - rows + 1, selected);
+}
+
+const std::string& ui_manager_ncurses::memo_row(const todo_list& todoList, int pos)
+{
+    if (memo_rows_revision != todoList.get_revision() || memo_rows.size() >= memo_rows_max) {
+        memo_rows.clear();
+        memo_rows_revision = todoList.get_revision();
+    }
+
+    auto [it, added] = memo_rows.try_emplace(pos);
+    if (added) {
+        const todo& memo = todoList[pos];
+        it->second = format("[{}] {}: {}", (memo.is_completed() ? "X" : " "), pos + 1, memo.get_title());
+    }
+    return it->second;
+}
+
+void ui_manager_ncurses::begin_view()
 {
-    ui_manager::login(current_user, all_users);
+    werase(header);
+    werase(list);
+    werase(bottom);
+    drawn.assign(getmaxy(list) - 1, {});
 }
 
 void ui_manager_ncurses::clear()
@@ -8,10 +8,10 @@
  *
  */
 
-#include <sstream>
-
 #include <cryptlib.h>
-#include <hex.h>
+#include <misc.h>
+#include <osrng.h>
+#include <pwdbased.h>
 #include <sha.h>
 
 #include "../include/user.h"
@@ -21,26 +21,39 @@ using namespace std;
 
 namespace p2d {
 ///////// PASSWORD //////////
-password::password(std::string_view pw)
-    : hash { create_hash(pw) } { }
+password::password(string_view pw, uint32_t iterations)
+    : iterations { iterations } {
+    CryptoPP::OS_GenerateRandomBlock(false, salt.data(), salt.size());
+    key = derive(pw, salt, iterations);
+}
 
-bool password::operator==(std::string_view other) const {
-    return hash == password(other).hash;
+bool password::operator==(string_view other) const {
+    return matches(other);
 }
 
-std::string password::create_hash(std::string_view pw) {
-    SHA256 hash;
-    CryptoPP::byte digest[SHA256::DIGESTSIZE];
+[[nodiscard]] bool password::matches(string_view attempt) const {
+    if (empty())
+        return false;
 
-    hash.CalculateDigest(digest, (CryptoPP::byte *)pw.data(), pw.size());
+    const key_type attempt_key = derive(attempt, salt, iterations);
+    return CryptoPP::VerifyBufsEqual(attempt_key.data(), key.data(), key.size());
+}
 
-    CryptoPP::HexEncoder encoder;
-    std::string output;
-    encoder.Attach(new CryptoPP::StringSink(output));
-    encoder.Put(digest, sizeof(digest));
-    encoder.MessageEnd();
+[[nodiscard]] uint32_t password::get_iterations() const {
+    return iterations;
+}
 
-    return output;
+[[nodiscard]] bool password::empty() const {
+    return iterations == 0;
+}
+
+password::key_type password::derive(string_view pw, const salt_type &salt, uint32_t iterations) {
+    key_type derived;
+    CryptoPP::PKCS5_PBKDF2_HMAC<SHA256> kdf;
+    kdf.DeriveKey(derived.data(), derived.size(), 0,
+        reinterpret_cast<const CryptoPP::byte *>(pw.data()), pw.size(),
+        salt.data(), salt.size(), iterations);
+    return derived;
 }
 
 istream &operator>>(istream &is, password &pw) {
@@ -62,18 +75,26 @@ user::user(const user &other) // drops password
     , email { other.email }
     , id { other.id } { }
 
-std::string user::get_name() const {
+[[nodiscard]] string_view user::get_name() const {
     return name;
 }
 
-std::string user::get_email() const {
+[[nodiscard]] string_view user::get_email() const {
     return email;
 }
 
-std::string user::get_id() const {
+[[nodiscard]] string_view user::get_id() const {
     return id;
 }
 
+[[nodiscard]] const password &user::get_password() const {
+    return pw;
+}
+
+void user::set_password(password &&new_pw) {
+    pw = move(new_pw);
+}
+
 user &user::operator=(const user &other) {
     name = other.name;
     email = other.email;
@@ -89,4 +110,12 @@ bool user::operator==(const user &other) const {
 strong_ordering user::operator<=>(const user &other) const {
     return id <=> other.id;
 }
+
+bool user::operator==(string_view id) const {
+    return this->id == id;
+}
+
+strong_ordering user::operator<=>(string_view id) const {
+    return string_view { this->id } <=> id;
+}
 }
\ No newline at end of file
@@ -9,40 +9,128 @@
  */
 
 #include <algorithm>
-#include <sstream>
 
 #include "../include/user_list.h"
 
 using namespace std;
 
 namespace p2d {
+namespace {
+    // The entry of multimap for exactly u
+    template <typename Map>
+    auto entry_of(Map &map, string_view key, const user &u) {
+        auto [first, last] = map.equal_range(key);
+        return find_if(first, last, [&u](const auto &entry) { return entry.second == &u; });
+    }
+}
+
 bool user_list::add(const user &u) {
-    return users.insert(u).second;
+    auto [it, inserted] = users.insert(u);
+    if (!inserted)
+        return false;
+
+    index(*it);
+    dirty = true;
+    return true;
+}
+
+bool user_list::add(user &&u) {
+    auto [it, inserted] = users.insert(move(u));
+    if (!inserted)
+        return false;
+
+    index(*it);
+    dirty = true;
+    return true;
+}
+
+bool user_list::set_password(string_view id, password &&pw) {
+    auto it = users.find(id);
+    if (it == users.end())
+        return false;
+
+    // The password is not part of the ordering, but set elements are const.
+    // The node keeps its address, so the secondary indexes stay valid.
+    auto node = users.extract(it);
+    node.value().set_password(move(pw));
+    users.insert(move(node));
+    dirty = true;
+    return true;
 }
 
 [[nodiscard]] const user &user_list::operator[](string_view id) const {
     return *find(id);
 }
 
-[[nodiscard]] set<user>::const_iterator user_list::find(string_view id) const {
-    return ranges::find_if(users, [id](const user &u) {
-        return u.get_id() == id;
-    });
+[[nodiscard]] user_list::user_set::const_iterator user_list::find(string_view id) const {
+    return users.find(id);
+}
+
+[[nodiscard]] vector<const user *> user_list::find_by_email(string_view email) const {
+    vector<const user *> found;
+    auto [first, last] = by_email.equal_range(email);
+    for (auto it = first; it != last; ++it) {
+        found.push_back(it->second);
+    }
+    ranges::sort(found, less {}, [](const user *u) { return u->get_id(); });
+    return found;
+}
+
+[[nodiscard]] vector<const user *> user_list::find_by_name(string_view prefix, size_t limit) const {
+    vector<const user *> found;
+    for (auto it = by_name.lower_bound(prefix); it != end(by_name) && found.size() < limit; ++it) {
+        if (!it->first.starts_with(prefix))
+            break;
+        found.push_back(it->second);
+    }
+    return found;
 }
 
 bool user_list::remove(string_view id) {
     if (auto user = find(id); user != end(users)) {
+        unindex(*user);
         users.erase(user);
+        dirty = true;
         return true;
     }
     return false;
 }
 
 [[nodiscard]] bool user_list::contains(string_view id) const {
-    return find(id) != end(users);
+    return users.contains(id);
 }
 
-[[nodiscard]] const set<user> &user_list::get_users() const {
+[[nodiscard]] const user_list::user_set &user_list::get_users() const {
     return users;
 }
-}
\ No newline at end of file
+
+[[nodiscard]] size_t user_list::size() const {
+    return users.size();
+}
+
+[[nodiscard]] bool user_list::is_dirty() const {
+    return dirty;
+}
+
+void user_list::mark_clean() {
+    dirty = false;
+}
+
+void user_list::index(const user &u) {
+    by_email.emplace(u.get_email(), &u);
+    by_name.emplace(u.get_name(), &u);
+}
+
+void user_list::unindex(const user &u) {
+    by_email.erase(entry_of(by_email, u.get_email(), u));
+    by_name.erase(entry_of(by_name, u.get_name(), u));
+}
+
+void user_list::reindex() {
+    by_email.clear();
+    by_name.clear();
+    for (const user &u : users) {
+        index(u);
+    }
+}
+}